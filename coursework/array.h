@@ -1,56 +1,102 @@
 #include <iostream>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+
+#include "allocator.h"
 
 
 #ifndef M_ARRAY_H
 #define M_ARRAY_H
 
-template <typename T>
-class array {
+/*
+ * dynamic array over raw storage: capacity doubles starting from the first element, only
+ * [0, size) holds constructed objects. Growth relocates elements with memcpy when T is
+ * trivially copyable and by move (copy if move may throw) otherwise. Sizes are 64-bit, so
+ * arrays may hold more than 2^31 elements. Storage comes from Allocator policy (allocator.h).
+ */
+template <typename T, typename Allocator = heap_allocator>
+class array : private Allocator {
     T* allocated_memory = nullptr;
-    int allocated_memory_size = 0;
+    int64_t allocated_memory_size = 0;
 
-    int size = 0;
+    int64_t size = 0;
 
-    void ensure_size(int size) {
-        if (allocated_memory_size < size) {
-            int old_size = allocated_memory_size;
-            while (allocated_memory_size < size) {
-                if (allocated_memory_size < 32) {
-                    allocated_memory_size += 16;
-                } else {
-                    allocated_memory_size *= 2;
-                }
+    T* allocate_elements(int64_t capacity) {
+        return static_cast<T*>(Allocator::allocate(sizeof(T) * (size_t) capacity, alignof(T)));
+    }
+
+    void free_elements(T* memory, int64_t capacity) {
+        if (memory != nullptr) {
+            Allocator::deallocate(memory, sizeof(T) * (size_t) capacity, alignof(T));
+        }
+    }
+
+    static void destroy(T* from, T* to) {
+        if (!std::is_trivially_destructible<T>::value) {
+            for (; from != to; from++) {
+                from->~T();
+            }
+        }
+    }
+
+    static void copy_construct(T* destination, T const* source, int64_t count) {
+        if (std::is_trivially_copyable<T>::value) {
+            if (count > 0) {
+                memcpy((void*) destination, (void const*) source, sizeof(T) * (size_t) count);
+            }
+        } else {
+            for (int64_t i = 0; i < count; i++) {
+                new (destination + i) T(source[i]);
             }
+        }
+    }
 
-            if (allocated_memory != nullptr) {
-                T* new_memory = new T[allocated_memory_size];
-                for (int i = 0; i < old_size; i++) {
-                    new_memory[i] = allocated_memory[i];
-                }
-                delete[] (allocated_memory);
-                allocated_memory = new_memory;
-            } else {
-                allocated_memory = new T[allocated_memory_size];
+    void reallocate(int64_t new_capacity) {
+        T* new_memory = new_capacity > 0 ? allocate_elements(new_capacity) : nullptr;
+        if (std::is_trivially_copyable<T>::value) {
+            if (size > 0) {
+                memcpy((void*) new_memory, (void const*) allocated_memory, sizeof(T) * (size_t) size);
+            }
+        } else {
+            for (int64_t i = 0; i < size; i++) {
+                new (new_memory + i) T(std::move_if_noexcept(allocated_memory[i]));
             }
+            destroy(allocated_memory, allocated_memory + size);
+        }
+        free_elements(allocated_memory, allocated_memory_size);
+        allocated_memory = new_memory;
+        allocated_memory_size = new_capacity;
+    }
+
+    void ensure_size(int64_t size) {
+        if (allocated_memory_size < size) {
+            int64_t new_size = allocated_memory_size > 0 ? allocated_memory_size : 4;
+            while (new_size < size) {
+                new_size *= 2;
+            }
+            reallocate(new_size);
         }
     }
 
 public:
     array() = default;
 
-    array(int size) {
+    array(int64_t size) {
         resize(size);
     }
 
-    array(array<T> const& other) {
+    array(Allocator const& allocator) : Allocator(allocator) {}
+
+    array(array const& other) : Allocator(other) {
         ensure_size(other.size);
+        copy_construct(allocated_memory, other.allocated_memory, other.size);
         size = other.size;
-        for (int i = 0; i < size; i++) {
-            allocated_memory[i] = other.allocated_memory[i];
-        }
     }
 
-    array(array<T>&& other) noexcept {
+    array(array&& other) noexcept : Allocator(other) {
         allocated_memory = other.allocated_memory;
         size = other.size;
         allocated_memory_size = other.allocated_memory_size;
@@ -59,56 +105,105 @@ public:
         other.allocated_memory_size = 0;
     }
 
-    array<T>& operator= (array<T> const& other) {
-        ensure_size(other.size);
-        size = other.size;
-        for (int i = 0; i < size; i++) {
-            allocated_memory[i] = other.allocated_memory[i];
+    array& operator= (array const& other) {
+        if (this != &other) {
+            destroy(allocated_memory, allocated_memory + size);
+            size = 0;
+            ensure_size(other.size);
+            copy_construct(allocated_memory, other.allocated_memory, other.size);
+            size = other.size;
         }
         return *this;
     }
 
-    array<T>& operator= (array<T>&& other) noexcept {
-        allocated_memory = other.allocated_memory;
-        size = other.size;
-        allocated_memory_size = other.allocated_memory_size;
-        other.allocated_memory = nullptr;
-        other.size = 0;
-        other.allocated_memory_size = 0;
+    array& operator= (array&& other) noexcept {
+        if (this != &other) {
+            clear();
+            Allocator::operator=(other);
+            allocated_memory = other.allocated_memory;
+            size = other.size;
+            allocated_memory_size = other.allocated_memory_size;
+            other.allocated_memory = nullptr;
+            other.size = 0;
+            other.allocated_memory_size = 0;
+        }
         return *this;
     }
 
-    int length() const {
+    int64_t length() const {
         return size;
     }
 
-    T& operator[] (int index) {
+    int64_t capacity() const {
+        return allocated_memory_size;
+    }
+
+    T& operator[] (int64_t index) {
         return allocated_memory[index];
     }
 
-    void resize(int new_size) {
-        if (new_size == 0) {
-            clear();
+    T const& operator[] (int64_t index) const {
+        return allocated_memory[index];
+    }
+
+    // new elements are value-initialized, extra elements are destroyed, capacity is kept
+    void resize(int64_t new_size) {
+        if (new_size < size) {
+            destroy(allocated_memory + new_size, allocated_memory + size);
         } else {
             ensure_size(new_size);
-            size = new_size;
+            for (int64_t i = size; i < new_size; i++) {
+                new (allocated_memory + i) T();
+            }
+        }
+        size = new_size;
+    }
+
+    void reserve(int64_t capacity) {
+        if (capacity > allocated_memory_size) {
+            reallocate(capacity);
+        }
+    }
+
+    void shrink_to_fit() {
+        if (allocated_memory_size > size) {
+            reallocate(size);
         }
     }
 
     T& add(T const& elem) {
-        ensure_size(size + 1);
-        return allocated_memory[size++] = elem;
+        if (size == allocated_memory_size) {
+            T copy(elem); // elem may live in memory that is about to be reallocated
+            ensure_size(size + 1);
+            return *new (allocated_memory + size++) T(std::move(copy));
+        }
+        return *new (allocated_memory + size++) T(elem);
+    }
+
+    T& add(T&& elem) {
+        if (size == allocated_memory_size) {
+            T moved(std::move(elem));
+            ensure_size(size + 1);
+            return *new (allocated_memory + size++) T(std::move(moved));
+        }
+        return *new (allocated_memory + size++) T(std::move(elem));
     }
 
-    void add_all(array<T> const& arr) {
-        for (int i = 0; i < arr.size; i++) {
-            add(arr[i]);
+    template <typename A>
+    void add_all(array<T, A> const& arr) {
+        int64_t count = arr.length();
+        if (count == 0) {
+            return;
         }
+        ensure_size(size + count);
+        copy_construct(allocated_memory + size, &arr[0], count);
+        size += count;
     }
 
     void clear() {
         if (allocated_memory != nullptr) {
-            delete[] (allocated_memory);
+            destroy(allocated_memory, allocated_memory + size);
+            free_elements(allocated_memory, allocated_memory_size);
             allocated_memory = nullptr;
         }
         size = allocated_memory_size = 0;
@@ -119,4 +214,4 @@ public:
     }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,280 @@
+#include <stdint.h>
+
+#include "array.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BIT_VECTOR_HARDWARE_POPCOUNT 1
+#endif
+
+#ifndef M_BIT_VECTOR_H
+#define M_BIT_VECTOR_H
+
+/*
+ * packed bits in 64-bit words (array<bit> spends a byte per bit). rank(i) and select(k) use
+ * an index built lazily on first query after a modification: cumulative popcount per 512-bit
+ * block, and the block of every SELECT_SAMPLE-th one bit, so select only scans between two
+ * samples. Word runs are counted with the popcnt instruction when the CPU has it (checked at run
+ * time, so the build needs no -mpopcnt), otherwise __builtin_popcountll falls back to software.
+ */
+class bit_vector {
+    static const int64_t BLOCK_WORDS = 8;
+    static const int64_t SELECT_SAMPLE = 4096;
+
+    array<uint64_t> words;
+    int64_t size = 0;
+
+    // rank index, valid only while index_dirty is false
+    mutable array<int64_t> block_ranks; // ones before each block, one extra entry for total
+    mutable array<int64_t> select_samples; // block containing (k * SELECT_SAMPLE)-th one
+    mutable bool index_dirty = true;
+
+#ifdef BIT_VECTOR_HARDWARE_POPCOUNT
+    __attribute__((target("popcnt")))
+    static int64_t popcount_hardware(uint64_t const* data, int64_t count) {
+        int64_t ones = 0;
+        for (int64_t i = 0; i < count; i++) {
+            ones += __builtin_popcountll(data[i]);
+        }
+        return ones;
+    }
+
+    static bool has_popcnt() {
+        static const bool supported = __builtin_cpu_supports("popcnt");
+        return supported;
+    }
+#endif
+
+    // one bits in count words starting at data
+    static int64_t popcount(uint64_t const* data, int64_t count) {
+#ifdef BIT_VECTOR_HARDWARE_POPCOUNT
+        if (has_popcnt()) {
+            return popcount_hardware(data, count);
+        }
+#endif
+        int64_t ones = 0;
+        for (int64_t i = 0; i < count; i++) {
+            ones += __builtin_popcountll(data[i]);
+        }
+        return ones;
+    }
+
+    static int popcount(uint64_t word) {
+        return (int) popcount(&word, 1);
+    }
+
+    // position of k-th (0-based) one bit in word, word must have more than k ones
+    static int select_in_word(uint64_t word, int k) {
+        for (int i = 0; i < k; i++) {
+            word &= word - 1;
+        }
+        return __builtin_ctzll(word);
+    }
+
+    static uint64_t low_mask(int count) {
+        return count >= 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+    }
+
+    void build_index() const {
+        int64_t block_count = (words.length() + BLOCK_WORDS - 1) / BLOCK_WORDS;
+        block_ranks.resize(block_count + 1);
+        select_samples.resize(0);
+        int64_t ones = 0;
+        for (int64_t block = 0; block < block_count; block++) {
+            block_ranks[block] = ones;
+            int64_t end = (block + 1) * BLOCK_WORDS < words.length() ? (block + 1) * BLOCK_WORDS : words.length();
+            int64_t block_ones = popcount(&words[block * BLOCK_WORDS], end - block * BLOCK_WORDS);
+            // every sample falling inside this block points to it
+            while (select_samples.length() * SELECT_SAMPLE < ones + block_ones) {
+                select_samples.add(block);
+            }
+            ones += block_ones;
+        }
+        block_ranks[block_count] = ones;
+        index_dirty = false;
+    }
+
+    void ensure_index() const {
+        if (index_dirty) {
+            build_index();
+        }
+    }
+
+public:
+    bit_vector() = default;
+
+    bit_vector(int64_t size, bool value = false) {
+        resize(size, value);
+    }
+
+    int64_t length() const {
+        return size;
+    }
+
+    int64_t word_count() const {
+        return words.length();
+    }
+
+    // bits past length() in the last word are always zero
+    uint64_t get_word(int64_t index) const {
+        return words[index];
+    }
+
+    bool get(int64_t index) const {
+        return (words[index >> 6] >> (index & 63)) & 1;
+    }
+
+    bool operator[] (int64_t index) const {
+        return get(index);
+    }
+
+    void set(int64_t index, bool value = true) {
+        uint64_t mask = uint64_t(1) << (index & 63);
+        if (value) {
+            words[index >> 6] |= mask;
+        } else {
+            words[index >> 6] &= ~mask;
+        }
+        index_dirty = true;
+    }
+
+    void reset(int64_t index) {
+        set(index, false);
+    }
+
+    // low count bits (count <= 64) of value are stored at [index, index + count), first bit at index
+    void set_bits(int64_t index, uint64_t value, int count) {
+        if (count == 0) {
+            return;
+        }
+        value &= low_mask(count);
+        int64_t word = index >> 6;
+        int offset = index & 63;
+        words[word] = (words[word] & ~(low_mask(count) << offset)) | (value << offset);
+        if (offset + count > 64) {
+            int spill = offset + count - 64;
+            words[word + 1] = (words[word + 1] & ~low_mask(spill)) | (value >> (64 - offset));
+        }
+        index_dirty = true;
+    }
+
+    // count bits (count <= 64) starting at index, first bit in the lowest position
+    uint64_t get_bits(int64_t index, int count) const {
+        if (count == 0) {
+            return 0;
+        }
+        int64_t word = index >> 6;
+        int offset = index & 63;
+        uint64_t value = words[word] >> offset;
+        if (offset + count > 64) {
+            value |= words[word + 1] << (64 - offset);
+        }
+        return value & low_mask(count);
+    }
+
+    void add(bool value) {
+        if ((size & 63) == 0) {
+            words.add(0);
+        }
+        size++;
+        if (value) {
+            words[(size - 1) >> 6] |= uint64_t(1) << ((size - 1) & 63);
+        }
+        index_dirty = true;
+    }
+
+    // appends low count bits (count <= 64) of value
+    void add_bits(uint64_t value, int count) {
+        int64_t index = size;
+        resize(size + count);
+        set_bits(index, value, count);
+    }
+
+    // new bits are set to value, capacity is kept
+    void resize(int64_t new_size, bool value = false) {
+        int64_t old_size = size;
+        int64_t old_words = words.length();
+        words.resize((new_size + 63) >> 6);
+        size = new_size;
+        if (new_size > old_size && value) {
+            if (old_size & 63) {
+                words[old_words - 1] |= ~low_mask(old_size & 63);
+            }
+            for (int64_t w = old_words; w < words.length(); w++) {
+                words[w] = ~uint64_t(0);
+            }
+        }
+        if (size & 63) {
+            words[words.length() - 1] &= low_mask(size & 63);
+        }
+        index_dirty = true;
+    }
+
+    void fill(bool value) {
+        for (int64_t w = 0; w < words.length(); w++) {
+            words[w] = value ? ~uint64_t(0) : 0;
+        }
+        if (size & 63) {
+            words[words.length() - 1] &= low_mask(size & 63);
+        }
+        index_dirty = true;
+    }
+
+    // total number of one bits
+    int64_t count() const {
+        ensure_index();
+        return block_ranks[block_ranks.length() - 1];
+    }
+
+    // number of one bits in [0, index), index <= length()
+    int64_t rank(int64_t index) const {
+        ensure_index();
+        int64_t word = index >> 6;
+        int64_t block = word / BLOCK_WORDS;
+        int64_t ones = block_ranks[block];
+        if (word > block * BLOCK_WORDS) {
+            ones += popcount(&words[block * BLOCK_WORDS], word - block * BLOCK_WORDS);
+        }
+        if (index & 63) {
+            ones += popcount(words[word] & low_mask(index & 63));
+        }
+        return ones;
+    }
+
+    // position of k-th (0-based) one bit, -1 if there are not more than k ones
+    int64_t select(int64_t k) const {
+        ensure_index();
+        if (k < 0 || k >= block_ranks[block_ranks.length() - 1]) {
+            return -1;
+        }
+        // binary search for last block with rank <= k between neighbouring samples
+        int64_t sample = k / SELECT_SAMPLE;
+        int64_t low = select_samples[sample];
+        int64_t high = sample + 1 < select_samples.length() ? select_samples[sample + 1] : block_ranks.length() - 2;
+        while (low < high) {
+            int64_t middle = (low + high + 1) / 2;
+            if (block_ranks[middle] <= k) {
+                low = middle;
+            } else {
+                high = middle - 1;
+            }
+        }
+        int64_t remaining = k - block_ranks[low];
+        for (int64_t w = low * BLOCK_WORDS; ; w++) {
+            int ones = popcount(words[w]);
+            if (remaining < ones) {
+                return (w << 6) + select_in_word(words[w], (int) remaining);
+            }
+            remaining -= ones;
+        }
+    }
+
+    void clear() {
+        words.clear();
+        block_ranks.clear();
+        select_samples.clear();
+        size = 0;
+        index_dirty = true;
+    }
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include <atomic>
+#include <thread>
+#include <stdint.h>
+#include <stddef.h>
+
+
+#ifndef M_CONCURRENT_QUEUE_H
+#define M_CONCURRENT_QUEUE_H
+
+/*
+ * bounded lock-free queues with the interface of Queue for handing work between threads,
+ * capacity is rounded up to power of two. try_enqueue/try_dequeue fail on full/empty queue,
+ * enqueue/dequeue spin (yielding) until they succeed. size() is exact only when no other
+ * thread works with the queue.
+ */
+
+static const int QUEUE_CACHE_LINE = 64;
+
+inline size_t queue_capacity(int capacity) {
+    size_t result = 2;
+    while (result < (size_t) capacity) {
+        result *= 2;
+    }
+    return result;
+}
+
+// single producer, single consumer: each side owns one index and caches the other one
+template <typename T>
+class SpscQueue {
+    T* buffer;
+    size_t mask;
+
+    alignas(QUEUE_CACHE_LINE) std::atomic<size_t> head {0}; // written by consumer
+    size_t cached_tail = 0;
+    alignas(QUEUE_CACHE_LINE) std::atomic<size_t> tail {0}; // written by producer
+    size_t cached_head = 0;
+
+public:
+    explicit SpscQueue(int capacity) : mask(queue_capacity(capacity) - 1) {
+        buffer = new T[mask + 1];
+    }
+
+    SpscQueue(SpscQueue const&) = delete;
+    SpscQueue& operator= (SpscQueue const&) = delete;
+
+    int size() const {
+        return (int) (tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire));
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    bool try_enqueue(T const& value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cached_head > mask) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (position - cached_head > mask) {
+                return false;
+            }
+        }
+        buffer[position & mask] = value;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_dequeue(T& value) {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (position == cached_tail) {
+                return false;
+            }
+        }
+        value = std::move(buffer[position & mask]);
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    void enqueue(T const& value) {
+        while (!try_enqueue(value)) {
+            std::this_thread::yield();
+        }
+    }
+
+    T dequeue() {
+        T value;
+        while (!try_dequeue(value)) {
+            std::this_thread::yield();
+        }
+        return value;
+    }
+
+    ~SpscQueue() {
+        delete[] (buffer);
+    }
+};
+
+// multiple producers and consumers: every cell has a sequence number telling which lap
+// of producers or consumers may use it next, positions are claimed by CAS
+template <typename T>
+class MpmcQueue {
+    struct cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    cell* cells;
+    size_t mask;
+
+    alignas(QUEUE_CACHE_LINE) std::atomic<size_t> enqueue_position {0};
+    alignas(QUEUE_CACHE_LINE) std::atomic<size_t> dequeue_position {0};
+
+public:
+    explicit MpmcQueue(int capacity) : mask(queue_capacity(capacity) - 1) {
+        cells = new cell[mask + 1];
+        for (size_t i = 0; i <= mask; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(MpmcQueue const&) = delete;
+    MpmcQueue& operator= (MpmcQueue const&) = delete;
+
+    int size() const {
+        size_t dequeued = dequeue_position.load(std::memory_order_acquire);
+        size_t enqueued = enqueue_position.load(std::memory_order_acquire);
+        return enqueued > dequeued ? (int) (enqueued - dequeued) : 0;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    bool try_enqueue(T const& value) {
+        size_t position = enqueue_position.load(std::memory_order_relaxed);
+        cell* target;
+        while (true) {
+            target = &cells[position & mask];
+            intptr_t diff = (intptr_t) target->sequence.load(std::memory_order_acquire) - (intptr_t) position;
+            if (diff == 0) {
+                if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // cell still holds value from previous lap
+            } else {
+                position = enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+        target->value = value;
+        target->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_dequeue(T& value) {
+        size_t position = dequeue_position.load(std::memory_order_relaxed);
+        cell* target;
+        while (true) {
+            target = &cells[position & mask];
+            intptr_t diff = (intptr_t) target->sequence.load(std::memory_order_acquire) - (intptr_t) (position + 1);
+            if (diff == 0) {
+                if (dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // producer has not filled this cell yet
+            } else {
+                position = dequeue_position.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(target->value);
+        target->sequence.store(position + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    void enqueue(T const& value) {
+        while (!try_enqueue(value)) {
+            std::this_thread::yield();
+        }
+    }
+
+    T dequeue() {
+        T value;
+        while (!try_dequeue(value)) {
+            std::this_thread::yield();
+        }
+        return value;
+    }
+
+    ~MpmcQueue() {
+        delete[] (cells);
+    }
+};
+
+#endif
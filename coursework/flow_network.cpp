@@ -5,7 +5,6 @@ FlowNetwork::NodeData::NodeData() {}
 FlowNetwork::NodeData::NodeData(std::string const &name) : name(name) {}
 
 void FlowNetwork::NodeData::reset() {
-    visited = false;
     path_next = path_last = nullptr;
 }
 
@@ -33,10 +32,13 @@ int FlowNetwork::EdgeData::remaining_flow() {
 
 void FlowNetwork::clear() {
     mGraph.clear();
+    visited.clear();
     source = target = nullptr;
 }
 
 void FlowNetwork::reset_vertices() {
+    visited.resize(mGraph.size());
+    visited.fill(false);
     mGraph.for_each([] (Vertex& vertex) -> void {
         vertex.data.reset();
     });
@@ -56,10 +58,10 @@ FlowNetwork::ValidationResult FlowNetwork::validate(FlowNetwork::Vertex *vertex,
         vertex = source;
         reset_vertices();
     }
-    if (vertex->data.visited) {
+    if (visited[vertex->index]) {
         return RESULT_CYCLE;
     }
-    vertex->data.visited = true;
+    visited.set(vertex->index);
     bool any = false;
 
     for (int i = 0; i < mGraph.size(); i++) {
@@ -75,7 +77,7 @@ FlowNetwork::ValidationResult FlowNetwork::validate(FlowNetwork::Vertex *vertex,
     if (!any && target != vertex) {
         return RESULT_INVALID_PATH;
     }
-    vertex->data.visited = false;
+    visited.reset(vertex->index);
     return RESULT_OK;
 }
 
@@ -83,8 +85,9 @@ array<FlowNetwork::Vertex *> FlowNetwork::bfs() {
     reset_vertices();
 
     Queue<Vertex*> queue;
+    queue.reserve(mGraph.size()); // every vertex is queued at most once
     queue.enqueue(source);
-    source->data.visited = true;
+    visited.set(source->index);
 
     while (!queue.empty()) {
         Vertex* vertex = queue.dequeue();
@@ -98,8 +101,8 @@ array<FlowNetwork::Vertex *> FlowNetwork::bfs() {
         }
 
         vertex->for_each([&] (Edge& edge) -> void {
-            if (!edge.connected->data.visited && edge.data.remaining_flow() > 0) {
-                edge.connected->data.visited = true;
+            if (!visited[edge.connected->index] && edge.data.remaining_flow() > 0) {
+                visited.set(edge.connected->index);
                 edge.connected->data.path_last = vertex;
                 queue.enqueue(edge.connected);
             }
@@ -168,7 +171,7 @@ FlowNetwork::Vertex &FlowNetwork::get_or_add_vertex(std::string const &name) {
 }
 
 bool FlowNetwork::add_edge_from_string(std::string line) {
-    array<std::string> tokens;
+    small_array<std::string, 4> tokens;
 
     char* token = strtok(line.data(), " ");
     while (token != nullptr) {
@@ -177,8 +180,14 @@ bool FlowNetwork::add_edge_from_string(std::string line) {
     }
 
     if (tokens.length() == 3) {
-        Vertex& vertex1 = get_or_add_vertex(tokens[0]);
+        // adding a vertex may move all of them, so pointers are taken again by index
+        int source_index = source != nullptr ? source->index : -1;
+        int target_index = target != nullptr ? target->index : -1;
+        int index1 = get_or_add_vertex(tokens[0]).index;
         Vertex& vertex2 = get_or_add_vertex(tokens[1]);
+        Vertex& vertex1 = mGraph.get_vertices()[index1];
+        source = source_index >= 0 ? &mGraph.get_vertices()[source_index] : nullptr;
+        target = target_index >= 0 ? &mGraph.get_vertices()[target_index] : nullptr;
         mGraph.connect(vertex1, vertex2, EdgeData(std::strtol(tokens[2].data(), nullptr, 10)));
         if (vertex1.data.name == "S") {
             source = &vertex1;
@@ -202,7 +211,7 @@ bool FlowNetwork::add_edge_from_string(std::string line) {
 bool FlowNetwork::read(std::string filename) {
     std::ifstream stream(filename);
     if (stream) {
-        mGraph.clear();
+        clear();
         std::string line;
         while (std::getline(stream, line)) {
             add_edge_from_string(line);
@@ -3,6 +3,8 @@
 
 #include "graph.h"
 #include "queue.h"
+#include "small_array.h"
+#include "bit_vector.h"
 
 #ifndef M_FLOW_NETWORK_H
 #define M_FLOW_NETWORK_H
@@ -19,7 +21,6 @@ public:
     public:
         std::string name;
 
-        bool visited = false;
         Vertex* path_next = nullptr;
         Vertex* path_last = nullptr;
 
@@ -53,6 +54,7 @@ public:
     Graph<NodeData, EdgeData> mGraph;
     Vertex* source = nullptr;
     Vertex* target = nullptr;
+    bit_vector visited; // by vertex index, cleared by reset_vertices
 
     void clear();
     void reset_vertices();
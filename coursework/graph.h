@@ -7,6 +7,7 @@
 
 #include "list.h"
 #include "array.h"
+#include "matrix.h"
 #include "canvas.h"
 
 
@@ -69,7 +70,7 @@ public:
 
         void for_each(std::function<void(Edge&)> func, bool iterateInactive = false) {
             for (int i = 0; i < graph->vertices.length(); i++) {
-                Edge& edge = graph->matrix[index][i];
+                Edge& edge = graph->edges[index][i];
                 if (iterateInactive || edge.active) {
                     func(edge);
                 }
@@ -79,7 +80,7 @@ public:
 
 private:
     array<Vertex> vertices;
-    array<array<Edge>> matrix;
+    matrix<Edge> edges;
 
 public:
     array<Vertex>& get_vertices() {
@@ -95,16 +96,16 @@ public:
     }
 
     void connect(Vertex& v1, Vertex& v2, E const& data) {
-        matrix[v1.index][v2.index].active = true;
-        matrix[v1.index][v2.index].data = data;
+        edges[v1.index][v2.index].active = true;
+        edges[v1.index][v2.index].data = data;
     }
 
     void disconnect(Vertex& v1, Vertex& v2) {
-        matrix[v1.index][v2.index].active = false;
+        edges[v1.index][v2.index].active = false;
     }
 
     Edge& get_edge(int index1, int index2) {
-        return matrix[index1][index2];
+        return edges[index1][index2];
     }
 
     Edge& get_edge(Vertex& v1, Vertex& v2) {
@@ -122,12 +123,14 @@ public:
     }
 
     Vertex& add_vertex(V const& data) {
+        Vertex* old_vertices = vertices.length() > 0 ? &vertices[0] : nullptr;
         Vertex& vertex = vertices.add(Vertex(this, vertices.length(), data));
-        matrix.resize(vertices.length());
-        for (int i = 0; i < matrix.length(); i++) {
-            matrix[i].resize(vertices.length());
-            for (int j = i == matrix.length() - 1 ? 0 : vertices.length() - 1; j < vertices.length(); j++) {
-                Edge &edge = matrix[i][j];
+        // edges keep vertex pointers, all of them are updated when vertices were moved
+        bool moved = old_vertices != nullptr && old_vertices != &vertices[0];
+        edges.resize(vertices.length(), vertices.length());
+        for (int i = 0; i < vertices.length(); i++) {
+            for (int j = i == vertices.length() - 1 || moved ? 0 : vertices.length() - 1; j < vertices.length(); j++) {
+                Edge &edge = edges[i][j];
                 edge.from = &vertices[i];
                 edge.connected = &vertices[j];
             }
@@ -144,7 +147,7 @@ public:
     void for_each(std::function<void(Edge&)> func, bool iterateInactive = false) {
         for (int i = 0; i < vertices.length(); i++) {
             for (int j = 0; j < vertices.length(); j++) {
-                Edge& edge = matrix[i][j];
+                Edge& edge = edges[i][j];
                 if (iterateInactive || edge.active) {
                     func(edge);
                 }
@@ -154,7 +157,7 @@ public:
 
     void clear() {
         vertices.clear();
-        matrix.clear();
+        edges.clear();
     }
 
     void print(int arrow_length, std::function<std::string(Vertex&)> vertex_to_string, std::function<std::string(Edge&)> edge_to_string) {
@@ -1,34 +1,102 @@
-#include "list.h"
+#include <utility>
 
 
 #ifndef M_QUEUE_H
 #define M_QUEUE_H
 
+// FIFO over a growable ring buffer, memory is kept after dequeue and clear, so a queue that
+// has reached its working size does not allocate anymore
 template <typename T>
 class Queue {
-    list<T> mList;
+    T* buffer = nullptr;
+    int capacity = 0; // always power of two
+    int head = 0;
+    int count = 0;
+
+    void grow(int min_capacity) {
+        int new_capacity = capacity < 16 ? 16 : capacity;
+        while (new_capacity < min_capacity) {
+            new_capacity *= 2;
+        }
+        if (new_capacity == capacity) {
+            return;
+        }
+        T* new_buffer = new T[new_capacity];
+        for (int i = 0; i < count; i++) {
+            new_buffer[i] = std::move(buffer[(head + i) & (capacity - 1)]);
+        }
+        delete[] (buffer);
+        buffer = new_buffer;
+        capacity = new_capacity;
+        head = 0;
+    }
+
 public:
+    Queue() = default;
+
+    Queue(Queue const& other) {
+        *this = other;
+    }
+
+    Queue(Queue&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    Queue& operator= (Queue const& other) {
+        if (this != &other) {
+            clear();
+            reserve(other.count);
+            for (int i = 0; i < other.count; i++) {
+                buffer[i] = other.buffer[(other.head + i) & (other.capacity - 1)];
+            }
+            count = other.count;
+        }
+        return *this;
+    }
+
+    Queue& operator= (Queue&& other) noexcept {
+        std::swap(buffer, other.buffer);
+        std::swap(capacity, other.capacity);
+        std::swap(head, other.head);
+        std::swap(count, other.count);
+        return *this;
+    }
+
     int size() const {
-        return mList.get_length();
+        return count;
     }
 
     bool empty() const {
-        return mList.get_length() == 0;
+        return count == 0;
     }
 
     T dequeue() {
-        auto node = mList._erase(mList.begin());
-        T result = std::move(node->value);
-        delete(node);
+        T result = std::move(buffer[head]);
+        head = (head + 1) & (capacity - 1);
+        count--;
         return result;
     }
 
     void enqueue(T const &value) {
-        mList.add(value);
+        if (count == capacity) {
+            grow(count + 1);
+        }
+        buffer[(head + count) & (capacity - 1)] = value;
+        count++;
+    }
+
+    void reserve(int size) {
+        if (size > capacity) {
+            grow(size);
+        }
     }
 
     void clear() {
-        mList.clear();
+        head = count = 0;
+    }
+
+    ~Queue() {
+        delete[] (buffer);
     }
 };
 
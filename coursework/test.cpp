@@ -1,11 +1,14 @@
 #include <string>
+#include <thread>
 
 #include "gtest/gtest.h"
 #include "rb_map.h"
 #include "array.h"
 #include "queue.h"
+#include "concurrent_queue.h"
 #include "graph.h"
 #include "flow_network.h"
+#include "bit_vector.h"
 
 
 // array tests
@@ -22,6 +25,47 @@ TEST (array, massive_add_and_check) {
     ASSERT_EQ(arr.length(), 0);
 }
 
+// bit vector tests
+TEST (bit_vector, rank_and_select) {
+    srand(7);
+    const int64_t size = 200000;
+    bit_vector bits;
+    array<int64_t> ones;
+    for (int64_t i = 0; i < size; i++) {
+        bool value = rand() % 5 == 0;
+        bits.add(value);
+        if (value) {
+            ones.add(i);
+        }
+    }
+    ASSERT_EQ(bits.length(), size);
+    ASSERT_EQ(bits.count(), ones.length());
+
+    int64_t rank = 0;
+    for (int64_t i = 0; i <= size; i++) {
+        ASSERT_EQ(bits.rank(i), rank);
+        if (i < size && bits[i]) {
+            rank++;
+        }
+    }
+    for (int64_t k = 0; k < ones.length(); k++) {
+        ASSERT_EQ(bits.select(k), ones[k]);
+    }
+    ASSERT_EQ(bits.select(ones.length()), -1);
+
+    // word level access across word borders invalidates index
+    bits.set_bits(60, 0x2D, 8);
+    ASSERT_EQ(bits.get_bits(60, 8), 0x2D);
+    ASSERT_EQ(bits.rank(68) - bits.rank(60), 4);
+    bits.resize(70, true);
+    bits.resize(130, true);
+    ASSERT_EQ(bits.get_bits(70, 60), (uint64_t(1) << 60) - 1);
+    bits.fill(false);
+    bits.set(129);
+    ASSERT_EQ(bits.count(), 1);
+    ASSERT_EQ(bits.select(0), 129);
+}
+
 // keep hardest test for rb_map
 TEST (rb_map, massive_random_load) {
     rb_map<int, int> map;
@@ -51,6 +95,83 @@ TEST (queue, queue_and_dequeue) {
     ASSERT_EQ(queue.dequeue(), "b");
 }
 
+TEST (queue, wrap_around_and_grow) {
+    Queue<int> queue;
+    int next_in = 0, next_out = 0;
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < round % 37; i++) {
+            queue.enqueue(next_in++);
+        }
+        for (int i = 0; i < round % 23 && !queue.empty(); i++) {
+            ASSERT_EQ(queue.dequeue(), next_out++);
+        }
+        ASSERT_EQ(queue.size(), next_in - next_out);
+    }
+
+    Queue<int> copy(queue);
+    while (!queue.empty()) {
+        ASSERT_EQ(queue.dequeue(), next_out);
+        ASSERT_EQ(copy.dequeue(), next_out++);
+    }
+    ASSERT_TRUE(copy.empty());
+    queue.clear();
+    ASSERT_EQ(queue.size(), 0);
+}
+
+TEST (queue, spsc_threads) {
+    SpscQueue<int> queue(64);
+    const int count = 1000000;
+    std::thread producer([&] () -> void {
+        for (int i = 0; i < count; i++) {
+            queue.enqueue(i);
+        }
+    });
+    bool ordered = true;
+    for (int i = 0; i < count; i++) {
+        ordered = ordered && queue.dequeue() == i;
+    }
+    producer.join();
+    ASSERT_TRUE(ordered);
+    ASSERT_TRUE(queue.empty());
+
+    int value;
+    ASSERT_FALSE(queue.try_dequeue(value));
+    for (int i = 0; i < 64; i++) {
+        ASSERT_TRUE(queue.try_enqueue(i));
+    }
+    ASSERT_FALSE(queue.try_enqueue(64));
+    ASSERT_EQ(queue.size(), 64);
+}
+
+TEST (queue, mpmc_threads) {
+    MpmcQueue<long long> queue(128);
+    const int threads = 4, count = 200000;
+    std::atomic<long long> total {0};
+
+    std::thread workers[threads * 2];
+    for (int t = 0; t < threads; t++) {
+        workers[t] = std::thread([&, t] () -> void {
+            for (int i = 0; i < count; i++) {
+                queue.enqueue((long long) t * count + i);
+            }
+        });
+        workers[threads + t] = std::thread([&] () -> void {
+            long long sum = 0;
+            for (int i = 0; i < count; i++) {
+                sum += queue.dequeue();
+            }
+            total += sum;
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    long long n = (long long) threads * count;
+    ASSERT_EQ(total.load(), n * (n - 1) / 2);
+    ASSERT_TRUE(queue.empty());
+}
+
 // test basic graph functionality
 TEST (graph, build_test) {
     Graph<std::string, std::string> graph;
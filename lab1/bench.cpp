@@ -0,0 +1,120 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+
+#include "list.h"
+#include "unrolled_list.h"
+#include "rb_map.h"
+#include "durable_map.h"
+
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void remove_durable_files(std::string const& path) {
+    remove((path + ".log").data());
+    remove((path + ".snapshot").data());
+}
+
+template <typename L>
+static void bench_list(char const* name, int count) {
+    auto start = std::chrono::steady_clock::now();
+    L values;
+    for (int i = 0; i < count; i++) {
+        values.add(i);
+    }
+    double add_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    long long sum = 0;
+    for (auto it = values.begin(); it != values.end(); it++) {
+        sum += *it;
+    }
+    double iterate_time = seconds_since(start);
+    std::cout << name << ": add " << add_time << "s, iterate " << iterate_time << "s (sum " << sum << ")\n";
+}
+
+int main() {
+    const int list_size = 10000000;
+    std::cout << "list<int> vs unrolled_list<int>, " << list_size << " elements\n";
+    bench_list<list<int>>("list", list_size);
+    bench_list<unrolled_list<int>>("unrolled_list", list_size);
+
+    std::cout << "\nrb_map<int, int> 1000000 random inserts and removes: ";
+    {
+        auto start = std::chrono::steady_clock::now();
+        rb_map<int, int> map;
+        for (int i = 0; i < 1000000; i++) {
+            map[rand() % 1000000] = i;
+        }
+        for (int i = 0; i < 1000000; i++) {
+            map.remove(rand() % 1000000);
+        }
+        std::cout << seconds_since(start) << "s\n\n";
+    }
+
+    std::string path = "durable_bench.tmp";
+    const int writes = 100000;
+
+    std::cout << "durable_rb_map<int, int> write throughput, " << writes << " random puts\n";
+    int batch_sizes[] = {1, 8, 64, 512, 4096};
+    for (int batch : batch_sizes) {
+        remove_durable_files(path);
+        durable_rb_map<int, int> map;
+        map.open(path, batch, 0);
+        int count = batch == 1 ? writes / 10 : writes;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            map[rand() % 1000000] = i;
+        }
+        map.flush();
+        double time = seconds_since(start);
+        std::cout << "fsync batch " << batch << ": " << (int) (count / time) << " writes/s\n";
+    }
+
+    const int entries = 1000000;
+    std::cout << "\nrecovery of " << entries << " entries\n";
+    {
+        remove_durable_files(path);
+        durable_rb_map<int, int> map;
+        map.open(path, 4096, 0);
+        for (int i = 0; i < entries; i++) {
+            map[i] = i;
+        }
+        auto start = std::chrono::steady_clock::now();
+        map.snapshot();
+        std::cout << "snapshot write: " << seconds_since(start) << "s\n";
+    }
+    {
+        auto start = std::chrono::steady_clock::now();
+        durable_rb_map<int, int> map;
+        map.open(path);
+        std::cout << "snapshot recovery: " << seconds_since(start) << "s (" << map.length() << " entries)\n";
+    }
+    {
+        auto start = std::chrono::steady_clock::now();
+        rb_map<int, int> map;
+        for (int i = 0; i < entries; i++) {
+            map[i] = i;
+        }
+        std::cout << "rebuild through operator[]: " << seconds_since(start) << "s\n";
+    }
+    {
+        remove_durable_files(path);
+        durable_rb_map<int, int> map;
+        map.open(path, 4096, 0);
+        for (int i = 0; i < entries; i++) {
+            map[i] = i;
+        }
+    }
+    {
+        auto start = std::chrono::steady_clock::now();
+        durable_rb_map<int, int> map;
+        map.open(path);
+        std::cout << "log replay recovery: " << seconds_since(start) << "s (" << map.length() << " entries)\n";
+    }
+    remove_durable_files(path);
+    return 0;
+}
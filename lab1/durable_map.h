@@ -0,0 +1,378 @@
+#include <string>
+#include <fstream>
+#include <type_traits>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "rb_map.h"
+
+
+#ifndef M_DURABLE_MAP_H
+#define M_DURABLE_MAP_H
+
+// binary encoding of keys and values inside log and snapshot records
+template <typename T, typename Enable = void>
+struct durable_codec;
+
+template <typename T>
+struct durable_codec<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    static void write(std::string& out, T const& value) {
+        out.append((char const*) &value, sizeof(T));
+    }
+
+    static bool read(char const*& data, char const* end, T& value) {
+        if (end - data < (long) sizeof(T)) {
+            return false;
+        }
+        memcpy(&value, data, sizeof(T));
+        data += sizeof(T);
+        return true;
+    }
+};
+
+template <>
+struct durable_codec<std::string> {
+    static void write(std::string& out, std::string const& value) {
+        durable_codec<uint32_t>::write(out, (uint32_t) value.size());
+        out.append(value);
+    }
+
+    static bool read(char const*& data, char const* end, std::string& value) {
+        uint32_t size;
+        if (!durable_codec<uint32_t>::read(data, end, size) || end - data < (long) size) {
+            return false;
+        }
+        value.assign(data, size);
+        data += size;
+        return true;
+    }
+};
+
+// FNV-1a, guards log records and snapshots against torn writes
+inline uint32_t durable_checksum(char const* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ (unsigned char) data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/*
+ * rb_map that survives restarts: every mutation is appended to <path>.log, log records are
+ * written and fsync'ed in groups of sync_batch (group commit), and every snapshot_interval
+ * records the whole map is written to <path>.snapshot in key order and the log is truncated.
+ * open() bulk-loads the snapshot and replays the log tail, dropping a torn last record.
+ */
+template <typename K, typename V>
+class durable_rb_map {
+public:
+    class io_exception : public std::exception {
+    public:
+        const char* what() const noexcept override {
+            return "durable_rb_map: failed to write log or snapshot";
+        }
+    };
+
+    class entry {
+        durable_rb_map& map;
+        K key;
+
+    public:
+        entry(durable_rb_map& map, K const& key) : map(map), key(key) {}
+
+        entry& operator= (V const& value) {
+            map.put(key, value);
+            return *this;
+        }
+
+        operator V const&() const {
+            return map.get(key);
+        }
+    };
+
+private:
+    enum record_type : char {
+        RECORD_PUT = 1,
+        RECORD_REMOVE = 2
+    };
+
+    static constexpr char const* SNAPSHOT_MAGIC = "RBMSNAP1";
+    static const int SNAPSHOT_MAGIC_SIZE = 8;
+
+    rb_map<K, V> map;
+    std::string path;
+    int log_fd = -1;
+
+    std::string pending_records;
+    int pending_count = 0;
+    int log_records = 0;
+
+    int sync_batch = 64;
+    int snapshot_interval = 1 << 16;
+
+    std::string log_path() const {
+        return path + ".log";
+    }
+
+    std::string snapshot_path() const {
+        return path + ".snapshot";
+    }
+
+    // makes rename() of a file in the map's directory durable
+    bool sync_directory() const {
+        size_t slash = path.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        int fd = ::open(directory.data(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) {
+            return false;
+        }
+        bool success = fsync(fd) == 0;
+        ::close(fd);
+        return success;
+    }
+
+    static bool read_file(std::string const& filename, std::string& content) {
+        std::ifstream stream(filename, std::ios::binary | std::ios::ate);
+        if (!stream) {
+            return false;
+        }
+        content.resize((size_t) stream.tellg());
+        stream.seekg(0);
+        return (bool) stream.read(&content[0], content.size());
+    }
+
+    static bool write_all(int fd, char const* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                return false;
+            }
+            data += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    void append_record(std::string const& payload) {
+        durable_codec<uint32_t>::write(pending_records, (uint32_t) payload.size());
+        durable_codec<uint32_t>::write(pending_records, durable_checksum(payload.data(), payload.size()));
+        pending_records += payload;
+        pending_count++;
+        log_records++;
+
+        if (pending_count >= sync_batch) {
+            flush();
+        }
+        if (snapshot_interval > 0 && log_records >= snapshot_interval) {
+            snapshot();
+        }
+    }
+
+    bool load_snapshot() {
+        std::string content;
+        if (!read_file(snapshot_path(), content)) {
+            return true; // nothing was snapshotted yet
+        }
+        if (content.size() < SNAPSHOT_MAGIC_SIZE + sizeof(uint64_t) + sizeof(uint32_t) ||
+            memcmp(content.data(), SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) != 0) {
+            return false;
+        }
+        char const* data = content.data() + SNAPSHOT_MAGIC_SIZE;
+        char const* end = content.data() + content.size() - sizeof(uint32_t);
+        uint32_t checksum;
+        memcpy(&checksum, end, sizeof(uint32_t));
+        if (checksum != durable_checksum(data, end - data)) {
+            return false;
+        }
+
+        uint64_t count;
+        if (!durable_codec<uint64_t>::read(data, end, count)) {
+            return false;
+        }
+        unrolled_list<K> keys;
+        unrolled_list<V> values;
+        for (uint64_t i = 0; i < count; i++) {
+            K key;
+            V value;
+            if (!durable_codec<K>::read(data, end, key) || !durable_codec<V>::read(data, end, value)) {
+                return false;
+            }
+            keys.add(key);
+            values.add(value);
+        }
+        map.load_sorted(keys, values);
+        return true;
+    }
+
+    bool replay_log() {
+        std::string content;
+        if (!read_file(log_path(), content)) {
+            return true;
+        }
+        char const* data = content.data();
+        char const* end = data + content.size();
+        while (data < end) {
+            char const* record = data;
+            uint32_t size, checksum;
+            if (!durable_codec<uint32_t>::read(data, end, size) || !durable_codec<uint32_t>::read(data, end, checksum) ||
+                size == 0 || end - data < (long) size || durable_checksum(data, size) != checksum) {
+                // torn tail of a crashed group commit, cut it off so new records follow valid ones
+                return truncate(log_path().data(), record - content.data()) == 0;
+            }
+
+            char const* payload_end = data + size;
+            char type = *data++;
+            K key;
+            if (!durable_codec<K>::read(data, payload_end, key)) {
+                return false;
+            }
+            if (type == RECORD_PUT) {
+                V value;
+                if (!durable_codec<V>::read(data, payload_end, value)) {
+                    return false;
+                }
+                map[key] = value;
+            } else {
+                map.remove(key);
+            }
+            data = payload_end;
+            log_records++;
+        }
+        return true;
+    }
+
+public:
+    durable_rb_map() = default;
+    durable_rb_map(durable_rb_map const&) = delete;
+    durable_rb_map& operator= (durable_rb_map const&) = delete;
+
+    // recovers map stored at path (or starts empty one), returns false if files can't be used
+    bool open(std::string const& path, int sync_batch = 64, int snapshot_interval = 1 << 16) {
+        close();
+        this->path = path;
+        this->sync_batch = sync_batch > 0 ? sync_batch : 1;
+        this->snapshot_interval = snapshot_interval;
+        log_records = 0;
+
+        map.clear();
+        if (!load_snapshot() || !replay_log()) {
+            map.clear();
+            return false;
+        }
+        log_fd = ::open(log_path().data(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        return log_fd >= 0;
+    }
+
+    // writes pending records and waits until they reach the disk
+    void flush() {
+        if (pending_count == 0) {
+            return;
+        }
+        if (log_fd < 0 || !write_all(log_fd, pending_records.data(), pending_records.size()) || fsync(log_fd) != 0) {
+            throw io_exception();
+        }
+        pending_records.clear();
+        pending_count = 0;
+    }
+
+    // writes sorted snapshot of the whole map and starts an empty log
+    void snapshot() {
+        flush();
+
+        std::string content(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+        durable_codec<uint64_t>::write(content, (uint64_t) map.length());
+        map.for_each([&] (K const& key, V& value) -> void {
+            durable_codec<K>::write(content, key);
+            durable_codec<V>::write(content, value);
+        });
+        durable_codec<uint32_t>::write(content, durable_checksum(content.data() + SNAPSHOT_MAGIC_SIZE, content.size() - SNAPSHOT_MAGIC_SIZE));
+
+        // new snapshot replaces old one atomically, a crash before log truncation only replays records again.
+        // Directory is synced before truncating the log: otherwise the truncation may reach disk while
+        // the rename does not, and records since the previous snapshot would be lost
+        std::string tmp_path = snapshot_path() + ".tmp";
+        int fd = ::open(tmp_path.data(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        bool success = fd >= 0 && write_all(fd, content.data(), content.size()) && fsync(fd) == 0;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        if (!success || rename(tmp_path.data(), snapshot_path().data()) != 0 || !sync_directory() ||
+            log_fd < 0 || ftruncate(log_fd, 0) != 0 || fsync(log_fd) != 0) {
+            throw io_exception();
+        }
+        log_records = 0;
+    }
+
+    void close() {
+        if (log_fd >= 0) {
+            flush();
+            ::close(log_fd);
+            log_fd = -1;
+        }
+    }
+
+    void put(K const& key, V const& value) {
+        std::string payload(1, RECORD_PUT);
+        durable_codec<K>::write(payload, key);
+        durable_codec<V>::write(payload, value);
+        map[key] = value;
+        append_record(payload);
+    }
+
+    bool remove(K const& key) {
+        if (!map.has(key)) {
+            return false;
+        }
+        std::string payload(1, RECORD_REMOVE);
+        durable_codec<K>::write(payload, key);
+        map.remove(key);
+        append_record(payload);
+        return true;
+    }
+
+    entry operator[] (K const& key) { // insert through assignment
+        return entry(*this, key);
+    }
+
+    V const& get(K const& key) {
+        auto node = map.find(key);
+        if (node == nullptr) {
+            throw typename rb_map<K, V>::invalid_key_exception();
+        }
+        return **node;
+    }
+
+    bool has(K const& key) {
+        return map.has(key);
+    }
+
+    int length() {
+        return map.length();
+    }
+
+    // records written since the last snapshot
+    int log_length() const {
+        return log_records;
+    }
+
+    int pending_length() const {
+        return pending_count;
+    }
+
+    rb_map<K, V>& get_map() {
+        return map;
+    }
+
+    ~durable_rb_map() {
+        try {
+            close();
+        } catch (io_exception&) {
+            // records that did not reach the log are lost as after a crash
+        }
+    }
+};
+
+#endif
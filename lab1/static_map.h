@@ -0,0 +1,103 @@
+#include <exception>
+#include <utility>
+#include <stddef.h>
+
+
+#ifndef M_STATIC_MAP_H
+#define M_STATIC_MAP_H
+
+/*
+ * read-only map over a key set known at compile time, entries are sorted while the constant
+ * is evaluated, so lookups are binary searches over an inline array without heap or startup cost
+ *
+ * constexpr auto codes = make_static_map<std::string_view, int>({{"b", 2}, {"a", 1}});
+ * static_assert(codes["a"] == 1);
+ */
+template <typename K, typename V, size_t N>
+class static_map {
+public:
+    struct entry {
+        K key;
+        V value;
+
+        constexpr V const& operator*() const {
+            return value;
+        }
+    };
+
+    class invalid_key_exception : public std::exception {
+
+    };
+
+private:
+    entry entries[N] = {};
+
+public:
+    // duplicate keys make the constant expression fail to compile
+    constexpr static_map(std::pair<K, V> const (&init)[N]) {
+        for (size_t i = 0; i < N; i++) {
+            entries[i].key = init[i].first;
+            entries[i].value = init[i].second;
+        }
+        for (size_t i = 1; i < N; i++) {
+            for (size_t j = i; j > 0 && entries[j].key < entries[j - 1].key; j--) {
+                entry tmp = entries[j];
+                entries[j] = entries[j - 1];
+                entries[j - 1] = tmp;
+            }
+        }
+        for (size_t i = 1; i < N; i++) {
+            if (entries[i].key == entries[i - 1].key) {
+                throw invalid_key_exception();
+            }
+        }
+    }
+
+    constexpr entry const* find(K const& key) const {
+        size_t low = 0, high = N;
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (entries[middle].key < key) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low < N && entries[low].key == key) {
+            return &entries[low];
+        }
+        return nullptr;
+    }
+
+    constexpr bool has(K const& key) const {
+        return find(key) != nullptr;
+    }
+
+    constexpr V const& operator[] (K const& key) const { // access
+        entry const* found = find(key);
+        if (found == nullptr) {
+            throw invalid_key_exception();
+        }
+        return found->value;
+    }
+
+    constexpr int length() const {
+        return (int) N;
+    }
+
+    // entries in ascending key order
+    constexpr entry const* begin() const {
+        return entries;
+    }
+
+    constexpr entry const* end() const {
+        return entries + N;
+    }
+};
+
+template <typename K, typename V, size_t N>
+constexpr static_map<K, V, N> make_static_map(std::pair<K, V> const (&entries)[N]) {
+    return static_map<K, V, N>(entries);
+}
+
+#endif
@@ -1,5 +1,10 @@
+#include <string_view>
+
 #include "gtest/gtest.h"
 #include "rb_map.h"
+#include "durable_map.h"
+#include "static_map.h"
+#include "unrolled_list.h"
 
 TEST (rb_map, fill_and_check_length) {
     rb_map<int, int> map;
@@ -116,4 +121,259 @@ TEST (rb_map, massive_random_load) {
 
     ASSERT_EQ(map.length(), map.tree_size());
     ASSERT_EQ(map.length(), remaining_length);
-}
\ No newline at end of file
+}
+
+TEST (rb_map, remove_keeps_order) {
+    rb_map<int, int> map;
+    for (int i = 0; i < 1000; i++) {
+        map[(i * 7919) % 1000] = i;
+    }
+    for (int i = 0; i < 1000; i += 3) {
+        ASSERT_TRUE(map.remove(i));
+    }
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(map.has(i), i % 3 != 0);
+    }
+    int last = -1;
+    map.for_each([&] (int const& key, int&) -> void {
+        ASSERT_LT(last, key);
+        last = key;
+    });
+    int count = 0;
+    for (auto it = map.keys().begin(); it != map.keys().end(); it++) {
+        ASSERT_NE(*it % 3, 0);
+        count++;
+    }
+    ASSERT_EQ(count, map.length());
+}
+
+TEST (rb_map, load_sorted) {
+    for (int size = 0; size < 70; size++) {
+        unrolled_list<int> keys, values;
+        for (int i = 0; i < size; i++) {
+            keys.add(i * 2);
+            values.add(i);
+        }
+        rb_map<int, int> map;
+        map[-1] = 0;
+        map.load_sorted(keys, values);
+        ASSERT_EQ(map.length(), size);
+        ASSERT_EQ(map.tree_size(), size);
+        ASSERT_FALSE(map.has(-1));
+        for (int i = 0; i < size; i++) {
+            ASSERT_EQ(**map.find(i * 2), i);
+            ASSERT_FALSE(map.has(i * 2 + 1));
+        }
+        map[1] = 5;
+        ASSERT_EQ(map.tree_size(), size + 1);
+        ASSERT_TRUE(map.remove(1));
+        ASSERT_EQ(map.tree_size(), size);
+    }
+}
+
+
+// durable map tests
+static void remove_durable_files(std::string const& path) {
+    remove((path + ".log").data());
+    remove((path + ".snapshot").data());
+}
+
+TEST (durable_rb_map, recover_from_log) {
+    std::string path = "durable_unit_test.tmp";
+    remove_durable_files(path);
+    {
+        durable_rb_map<int, std::string> map;
+        ASSERT_TRUE(map.open(path, 8, 0));
+        for (int i = 0; i < 100; i++) {
+            map[i] = std::to_string(i);
+        }
+        for (int i = 0; i < 100; i += 2) {
+            ASSERT_TRUE(map.remove(i));
+        }
+        ASSERT_FALSE(map.remove(0));
+        map[1] = "one";
+    }
+
+    durable_rb_map<int, std::string> map;
+    ASSERT_TRUE(map.open(path));
+    ASSERT_EQ(map.length(), 50);
+    ASSERT_EQ(map.get(1), "one");
+    for (int i = 2; i < 100; i++) {
+        ASSERT_EQ(map.has(i), i % 2 == 1);
+        if (i % 2 == 1) {
+            ASSERT_EQ(std::string(map[i]), std::to_string(i));
+        }
+    }
+    map.close();
+    remove_durable_files(path);
+}
+
+TEST (durable_rb_map, recover_from_snapshot_and_log) {
+    std::string path = "durable_unit_test.tmp";
+    remove_durable_files(path);
+    {
+        durable_rb_map<std::string, int> map;
+        ASSERT_TRUE(map.open(path, 16, 100));
+        for (int i = 0; i < 1050; i++) {
+            map[std::to_string(i % 500)] = i;
+        }
+        ASSERT_EQ(map.log_length(), 50);
+        map.remove("7");
+    }
+
+    durable_rb_map<std::string, int> map;
+    ASSERT_TRUE(map.open(path));
+    ASSERT_EQ(map.length(), 499);
+    ASSERT_EQ(map.get_map().tree_size(), 499);
+    ASSERT_FALSE(map.has("7"));
+    for (int i = 0; i < 500; i++) {
+        if (i != 7) {
+            ASSERT_EQ(map.get(std::to_string(i)), i < 50 ? i + 1000 : i + 500);
+        }
+    }
+    map.close();
+    remove_durable_files(path);
+}
+
+TEST (durable_rb_map, torn_log_tail) {
+    std::string path = "durable_unit_test.tmp";
+    remove_durable_files(path);
+    {
+        durable_rb_map<int, int> map;
+        ASSERT_TRUE(map.open(path, 1, 0));
+        map[1] = 10;
+        map[2] = 20;
+    }
+    {
+        // half written record of a crashed commit
+        std::ofstream log(path + ".log", std::ios::binary | std::ios::app);
+        log.write("\x09\x00\x00\x00\x01", 5);
+    }
+    {
+        durable_rb_map<int, int> map;
+        ASSERT_TRUE(map.open(path));
+        ASSERT_EQ(map.length(), 2);
+        map[3] = 30;
+    }
+
+    durable_rb_map<int, int> map;
+    ASSERT_TRUE(map.open(path));
+    ASSERT_EQ(map.length(), 3);
+    ASSERT_EQ(map.get(3), 30);
+    map.close();
+    remove_durable_files(path);
+}
+
+
+// static map tests
+constexpr auto test_static_map = make_static_map<std::string_view, int>({
+    {"delta", 4}, {"alpha", 1}, {"echo", 5}, {"charlie", 3}, {"bravo", 2}
+});
+static_assert(test_static_map["alpha"] == 1, "lookup must be available at compile time");
+static_assert(test_static_map.has("echo") && !test_static_map.has("foxtrot"), "lookup must be available at compile time");
+
+TEST (static_map, find_and_has) {
+    ASSERT_EQ(test_static_map.length(), 5);
+    ASSERT_EQ(test_static_map["charlie"], 3);
+    ASSERT_EQ(**test_static_map.find(std::string("delta")), 4);
+    ASSERT_EQ(test_static_map.find("foxtrot"), nullptr);
+    ASSERT_FALSE(test_static_map.has(""));
+    ASSERT_THROW(test_static_map["zulu"], decltype(test_static_map)::invalid_key_exception);
+
+    int value = 1;
+    for (auto& entry : test_static_map) {
+        ASSERT_EQ(entry.value, value++);
+    }
+}
+
+TEST (static_map, matches_rb_map) {
+    constexpr auto squares = make_static_map<int, int>({{9, 81}, {3, 9}, {-2, 4}, {0, 0}, {7, 49}, {1, 1}});
+    rb_map<int, int> map;
+    for (auto& entry : squares) {
+        map[entry.key] = entry.value;
+    }
+    for (int i = -5; i < 12; i++) {
+        ASSERT_EQ(squares.has(i), map.has(i));
+        if (map.has(i)) {
+            ASSERT_EQ(squares[i], map[i]);
+        }
+    }
+}
+
+
+// unrolled list tests
+TEST (unrolled_list, add_erase_and_iterate) {
+    unrolled_list<std::string, 4> list;
+    unrolled_list<std::string, 4>::iterator iterators[100];
+    for (int i = 0; i < 100; i++) {
+        iterators[i] = list.add(std::to_string(i));
+    }
+    ASSERT_EQ(list.get_length(), 100);
+    for (int i = 0; i < 100; i++) {
+        if (i % 3 != 0 || (i >= 40 && i < 60)) {
+            list.erase(iterators[i]);
+        }
+    }
+
+    // iterators of remaining elements are still valid
+    int count = 0;
+    for (int i = 0; i < 100; i++) {
+        if (i % 3 == 0 && (i < 40 || i >= 60)) {
+            ASSERT_EQ(*iterators[i], std::to_string(i));
+            count++;
+        }
+    }
+    ASSERT_EQ(list.get_length(), count);
+
+    int last = -1;
+    for (auto it = list.begin(); it != list.end(); it++) {
+        int value = std::stoi(*it);
+        ASSERT_LT(last, value);
+        ASSERT_EQ(value % 3, 0);
+        last = value;
+        count--;
+    }
+    ASSERT_EQ(count, 0);
+
+    auto it = iterators[99];
+    it--;
+    ASSERT_EQ(*it, "96");
+    it = iterators[60];
+    it--;
+    ASSERT_EQ(*it, "39");
+}
+
+TEST (unrolled_list, splice_and_bulk_add) {
+    int values[37];
+    for (int i = 0; i < 37; i++) {
+        values[i] = i;
+    }
+    unrolled_list<int, 8> list1, list2;
+    list1.add_all(values, 37);
+    auto kept = list2.add(100);
+    list2.add_all(values, 5);
+    list1.splice(list2);
+    ASSERT_EQ(list2.get_length(), 0);
+    ASSERT_EQ(list2.begin(), list2.end());
+    ASSERT_EQ(list1.get_length(), 43);
+    ASSERT_EQ(*kept, 100);
+    list1.add(200);
+
+    int expected[] = {100, 0, 1, 2, 3, 4, 200};
+    auto it = list1.begin();
+    for (int i = 0; i < 37; i++) {
+        ASSERT_EQ(*it++, i);
+    }
+    for (int value : expected) {
+        ASSERT_EQ(*it++, value);
+    }
+    ASSERT_EQ(it, list1.end());
+
+    unrolled_list<int, 8> copy(list1);
+    copy.add_all(copy);
+    ASSERT_EQ(copy.get_length(), 88);
+    list1.clear();
+    ASSERT_EQ(list1.get_length(), 0);
+    list1.add_all(values, 3);
+    ASSERT_EQ(*list1.begin(), 0);
+}
@@ -0,0 +1,276 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array.h"
+#include "sort.h"
+#include "huffman.h"
+
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename T, typename F>
+static void bench_sort(char const* name, array<T> const& source, F const& sort) {
+    array<T> values(source);
+    auto start = std::chrono::steady_clock::now();
+    sort(values);
+    double time = seconds_since(start);
+    bool sorted = std::is_sorted(&values[0], &values[0] + values.length());
+    std::cout << "  " << name << ": " << time << "s" << (sorted ? "" : " (NOT SORTED)") << "\n";
+}
+
+template <typename T>
+static void bench_all(char const* type, array<T> const& source) {
+    std::cout << type << ", " << source.length() << " elements\n";
+    bench_sort("std::sort", source, [] (array<T>& values) -> void {
+        std::sort(&values[0], &values[0] + values.length());
+    });
+    bench_sort("radix_sort", source, [] (array<T>& values) -> void {
+        radix_sort(values);
+    });
+    bench_sort("parallel_sort", source, [] (array<T>& values) -> void {
+        parallel_sort(values);
+    });
+    bench_sort("stable_sort", source, [] (array<T>& values) -> void {
+        stable_sort(values);
+    });
+}
+
+// text of random words with skewed frequencies, close to natural language symbol statistics
+static std::string make_corpus(int64_t size) {
+    const char* words[] = {"the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with",
+                           "be", "by", "on", "not", "he", "this", "are", "or", "his", "from", "at", "which",
+                           "huffman", "buffer", "vertex", "Graph", "queue", "42", "1987,", "flow.\n"};
+    const int word_count = sizeof(words) / sizeof(words[0]);
+    std::mt19937 random(7);
+    std::string corpus;
+    corpus.reserve(size + 16);
+    while ((int64_t) corpus.size() < size) {
+        int index = (int) (random() % word_count);
+        index = (int) (random() % (index + 1)); // earlier words are more frequent
+        corpus += words[index];
+        corpus += ' ';
+    }
+    corpus.resize(size);
+    return corpus;
+}
+
+#ifndef LAB2_DATA_PATH
+#define LAB2_DATA_PATH "data.txt"
+#endif
+
+// lab2 test corpus, empty if file can't be read
+static std::string read_data_file() {
+    std::ifstream file(LAB2_DATA_PATH, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+// small corpus repeated up to size, so throughput is measured on its symbol statistics
+static std::string repeat_to_size(std::string const& data, int64_t size) {
+    std::string result;
+    result.reserve(size + data.size());
+    while ((int64_t) result.size() < size) {
+        result += data;
+    }
+    result.resize(size);
+    return result;
+}
+
+static void bench_huffman(char const* name, std::string const& corpus) {
+    int64_t size = (int64_t) corpus.size();
+    double megabytes = size / 1e6;
+
+    auto start = std::chrono::steady_clock::now();
+    bit_buffer encoded = huffman_codec::encode(corpus);
+    double encode_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    std::string decoded = huffman_codec::decode(encoded);
+    double decode_time = seconds_since(start);
+
+    std::cout << "huffman, " << size << " bytes of " << name << " -> " << encoded.length_bytes() << " bytes\n";
+    std::cout << "  encode: " << megabytes / encode_time << " MB/s\n";
+    std::cout << "  decode: " << megabytes / decode_time << " MB/s" << (decoded == corpus ? "" : " (MISMATCH)") << "\n";
+
+    // independent blocks on all hardware threads
+    start = std::chrono::steady_clock::now();
+    bit_buffer blocks = huffman_codec::encode_blocks(corpus);
+    encode_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    decoded = huffman_codec::decode_blocks(blocks);
+    decode_time = seconds_since(start);
+
+    std::cout << "  blocks of " << huffman_codec::DEFAULT_BLOCK_SIZE << " bytes -> " << blocks.length_bytes() << " bytes\n";
+    std::cout << "  block encode: " << megabytes / encode_time << " MB/s\n";
+    std::cout << "  block decode: " << megabytes / decode_time << " MB/s" << (decoded == corpus ? "" : " (MISMATCH)") << "\n";
+
+    start = std::chrono::steady_clock::now();
+    bit_buffer interleaved = huffman_codec::encode_blocks(corpus, huffman_codec::DEFAULT_BLOCK_SIZE, 0, true);
+    encode_time = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    decoded = huffman_codec::decode_blocks(interleaved);
+    decode_time = seconds_since(start);
+
+    std::cout << "  interleaved blocks -> " << interleaved.length_bytes() << " bytes\n";
+    std::cout << "  interleaved encode: " << megabytes / encode_time << " MB/s\n";
+    std::cout << "  interleaved decode: " << megabytes / decode_time << " MB/s" << (decoded == corpus ? "" : " (MISMATCH)") << "\n\n";
+}
+
+// per-bit calls against bulk calls on the same bit stream of 13-bit fields
+static void bench_bit_buffer(int64_t bits) {
+    const int width = 13;
+    int64_t fields = bits / width;
+    std::cout << "bit_buffer, " << fields * width << " bits in " << width << "-bit fields\n";
+    uint64_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    bit_buffer single;
+    for (int64_t i = 0; i < fields; i++) {
+        for (int j = 0; j < width; j++) {
+            single.write_bit(bit((i >> j) & 1));
+        }
+    }
+    std::cout << "  write_bit: " << seconds_since(start) << "s\n";
+
+    start = std::chrono::steady_clock::now();
+    bit_buffer bulk;
+    for (int64_t i = 0; i < fields; i++) {
+        bulk.write_bits((uint64_t) i & 0x1FFF, width);
+    }
+    std::cout << "  write_bits: " << seconds_since(start) << "s\n";
+
+    start = std::chrono::steady_clock::now();
+    bit_buffer accumulated;
+    {
+        bit_buffer::writer writer(accumulated);
+        for (int64_t i = 0; i < fields; i++) {
+            writer.write((uint64_t) i & 0x1FFF, width);
+        }
+        writer.flush();
+    }
+    std::cout << "  writer: " << seconds_since(start) << "s\n";
+
+    start = std::chrono::steady_clock::now();
+    single.rewind();
+    for (int64_t i = 0; i < fields; i++) {
+        uint64_t value = 0;
+        for (int j = 0; j < width; j++) {
+            value |= (uint64_t) single.next_bit() << j;
+        }
+        checksum += value;
+    }
+    std::cout << "  next_bit: " << seconds_since(start) << "s\n";
+
+    start = std::chrono::steady_clock::now();
+    bulk.rewind();
+    for (int64_t i = 0; i < fields; i++) {
+        checksum += bulk.read_bits(width);
+    }
+    std::cout << "  read_bits: " << seconds_since(start) << "s\n";
+
+    start = std::chrono::steady_clock::now();
+    accumulated.rewind();
+    bit_buffer::reader reader(accumulated);
+    for (int64_t i = 0; i < fields; i++) {
+        checksum += reader.read(width);
+    }
+    std::cout << "  reader: " << seconds_since(start) << "s (checksum " << checksum << ")\n\n";
+}
+
+// byte histogram against plain single-table counting, runs of one byte are the worst case for it
+static void bench_histogram(char const* name, std::string const& input) {
+    double megabytes = input.size() / 1e6;
+    auto start = std::chrono::steady_clock::now();
+    huffman_tree::char_weights weights(input);
+    double histogram_time = seconds_since(start);
+
+    int64_t simple_weights[256] = {0};
+    start = std::chrono::steady_clock::now();
+    for (char c : input) {
+        simple_weights[(unsigned char) c]++;
+    }
+    double simple_time = seconds_since(start);
+    bool same = memcmp(simple_weights, weights.weights, sizeof(simple_weights)) == 0;
+    std::cout << "histogram, " << name << ": char_weights " << megabytes / histogram_time << " MB/s, single table "
+              << megabytes / simple_time << " MB/s" << (same ? "" : " (MISMATCH)") << "\n";
+}
+
+// compressed size with limited code lengths against unlimited huffman codes
+static void bench_code_limits(char const* name, std::string const& corpus) {
+    huffman_tree unlimited(corpus);
+    int64_t optimal = unlimited.calculate_size();
+    std::cout << "code length limits, " << name << " (" << corpus.size() << " bytes, unlimited " << optimal / 8 << " bytes)\n";
+    const int limits[] = {5, 6, 8, 9, 11, 13, 15};
+    for (int limit : limits) {
+        huffman_tree limited(corpus, limit);
+        // limits below ceil(log2(symbol count)) are raised by the tree and would repeat a longer row
+        if (limited.get_max_code_length() > limit) {
+            std::cout << "  max " << limit << " bits: too few for symbol count, skipped\n";
+            continue;
+        }
+        int64_t size = limited.calculate_size();
+        std::cout << "  max " << limit << " bits: " << size / 8 << " bytes, +" << (size - optimal) * 100.0 / optimal << "%\n";
+    }
+    std::cout << "\n";
+}
+
+// usage: lab2_bench [max elements], sizes go from 1e6 up to max by 10x (default 1e8, 1e9 needs ~12 GB)
+int main(int argc, char** argv) {
+    int64_t max_size = argc > 1 ? atoll(argv[1]) : 100000000;
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n\n";
+
+    bench_bit_buffer(int64_t(1) << 28);
+    bench_histogram("text", make_corpus(64 << 20));
+    bench_histogram("one byte runs", std::string(64 << 20, 'x'));
+    std::cout << "\n";
+    bench_huffman("text", make_corpus(64 << 20));
+    std::string data = read_data_file();
+    if (data.empty()) {
+        std::cout << "can't read " << LAB2_DATA_PATH << ", skipping data.txt runs\n\n";
+    } else {
+        bench_huffman("data.txt repeated", repeat_to_size(data, 64 << 20));
+    }
+
+    bench_code_limits("text", make_corpus(16 << 20));
+    std::string skewed;
+    std::mt19937 skewed_random(3);
+    for (int i = 0; i < (16 << 20); i++) {
+        // geometric symbol distribution, p(k) = 2^-(k+1)
+        uint32_t r = (uint32_t) skewed_random() | 1u << 31;
+        skewed += char('a' + __builtin_ctz(r));
+    }
+    bench_code_limits("geometric", skewed);
+    if (!data.empty()) {
+        bench_code_limits("data.txt", data);
+    }
+
+    std::mt19937_64 random(42);
+    for (int64_t size = 1000000; size <= max_size; size *= 10) {
+        array<uint32_t> ints(size);
+        for (int64_t i = 0; i < size; i++) {
+            ints[i] = (uint32_t) random();
+        }
+        bench_all("uint32_t", ints);
+        ints.clear();
+
+        array<double> doubles(size);
+        std::normal_distribution<double> normal;
+        for (int64_t i = 0; i < size; i++) {
+            doubles[i] = normal(random);
+        }
+        bench_all("double", doubles);
+        std::cout << "\n";
+    }
+    return 0;
+}
@@ -1,5 +1,6 @@
 
 #include <iostream>
+#include <new>
 #include <stdlib.h>
 #include <string.h>
 #include "buffer.h"
@@ -7,11 +8,7 @@
 bit_buffer::bit_buffer() = default;
 
 bit_buffer::bit_buffer(bit_buffer const& other) {
-    allocated_size = other.allocated_size;
-    size = other.size;
-    position = other.position;
-    buffer_memory = (byte*) malloc(allocated_size);
-    memcpy(buffer_memory, other.buffer_memory, size);
+    *this = other;
 }
 
 bit_buffer::bit_buffer(bit_buffer&& other) {
@@ -24,22 +21,36 @@ bit_buffer::bit_buffer(bit_buffer&& other) {
 }
 
 bit_buffer::bit_buffer(array<bit> const& bits) {
-    int len = bits.length();
-    for (int i = 0; i < len; i++) {
+    int64_t len = bits.length();
+    for (int64_t i = 0; i < len; i++) {
+        write_bit(bits[i]);
+    }
+}
+
+bit_buffer::bit_buffer(bit const* bits, int64_t count) {
+    for (int64_t i = 0; i < count; i++) {
         write_bit(bits[i]);
     }
 }
 
 bit_buffer& bit_buffer::operator=(bit_buffer const& other) {
-    allocated_size = other.allocated_size;
-    size = other.size;
-    position = other.position;
-    buffer_memory = (byte*) malloc(allocated_size);
-    memcpy(buffer_memory, other.buffer_memory, size);
+    if (this != &other) {
+        clear();
+        ensure_size(other.size);
+        size = other.size;
+        position = other.position;
+        if (size > 0) {
+            memcpy(buffer_memory, other.buffer_memory, (size_t) other.length_bytes());
+        }
+    }
     return *this;
 }
 
 bit_buffer& bit_buffer::operator=(bit_buffer&& other) {
+    if (this == &other) {
+        return *this;
+    }
+    clear();
     allocated_size = other.allocated_size;
     size = other.size;
     buffer_memory = other.buffer_memory;
@@ -49,20 +60,35 @@ bit_buffer& bit_buffer::operator=(bit_buffer&& other) {
     return *this;
 }
 
-void bit_buffer::ensure_size(int size) {
+void bit_buffer::ensure_size(int64_t size) {
     if (size > allocated_size * 8) {
-        while (size > allocated_size * 8) {
-            if (allocated_size < 2048) {
-                allocated_size += 1024;
+        int64_t new_size = allocated_size;
+        while (size > new_size * 8) {
+            if (new_size < 2048) {
+                new_size += 1024;
             } else {
-                allocated_size *= 2;
+                new_size *= 2;
             }
         }
-        if (buffer_memory != nullptr) {
-            buffer_memory = (byte*) realloc(buffer_memory, allocated_size);
-        } else {
-            buffer_memory = (byte*) malloc(allocated_size);
+        byte* new_memory = (byte*) realloc(buffer_memory, (size_t) new_size);
+        if (new_memory == nullptr) {
+            throw std::bad_alloc();
         }
+        buffer_memory = new_memory;
+        allocated_size = new_size;
+    }
+}
+
+// allocates memory for given total size in bits up front, so following writes don't reallocate
+void bit_buffer::reserve(int64_t bits) {
+    int64_t bytes = (bits + 7) / 8;
+    if (bytes > allocated_size) {
+        byte* new_memory = (byte*) realloc(buffer_memory, (size_t) bytes);
+        if (new_memory == nullptr) {
+            throw std::bad_alloc();
+        }
+        buffer_memory = new_memory;
+        allocated_size = bytes;
     }
 }
 
@@ -70,18 +96,18 @@ byte* bit_buffer::get_buffer() const {
     return buffer_memory;
 }
 
-int bit_buffer::length_bits() const {
+int64_t bit_buffer::length_bits() const {
     return size;
 }
 
-int bit_buffer::length_bytes() const {
+int64_t bit_buffer::length_bytes() const {
     return (size + 7) / 8;
 }
 
-void bit_buffer::write_bytes(byte const *buffer, int size) {
-    ensure_size(this->size + size);
+void bit_buffer::write_bytes(byte const *buffer, int64_t size) {
     this->size = ((this->size + 7) / 8) * 8;
-    memcpy(this->buffer_memory + this->size / 8, buffer, size);
+    ensure_size(this->size + size * 8);
+    memcpy(this->buffer_memory + this->size / 8, buffer, (size_t) size);
     this->size += size * 8;
 }
 
@@ -91,19 +117,56 @@ void bit_buffer::write_bit(bit b) {
         write_byte((bit) b);
         size -= 7;
     } else {
-        int last = size / 8;
-        int pos = size % 8;
+        int64_t last = size / 8;
+        int pos = (int) (size % 8);
         buffer_memory[last] = (byte) ((buffer_memory[last] & ~(1 << pos)) | (b << pos));
         size++;
     }
 }
 
+static uint64_t low_mask(int count) {
+    return count >= 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static const bool LITTLE_ENDIAN_WORDS = true;
+#else
+static const bool LITTLE_ENDIAN_WORDS = false;
+#endif
+
+// appends low count bits (count <= 64) of value with one 64-bit store when possible
+void bit_buffer::write_bits(uint64_t value, int count) {
+    if (count == 0) {
+        return;
+    }
+    value &= low_mask(count);
+    int64_t index = size / 8;
+    int offset = (int) (size % 8);
+    ensure_size((index + 9) * 8);
+    byte* memory = buffer_memory + index;
+    if (LITTLE_ENDIAN_WORDS) {
+        uint64_t word;
+        memcpy(&word, memory, 8);
+        word = (word & low_mask(offset)) | (value << offset);
+        memcpy(memory, &word, 8);
+    } else {
+        memory[0] = (byte) ((memory[0] & low_mask(offset)) | (value << offset));
+        for (int i = 1; i < 8; i++) {
+            memory[i] = (byte) (value >> (i * 8 - offset));
+        }
+    }
+    if (offset + count > 64) {
+        memory[8] = (byte) (value >> (64 - offset));
+    }
+    size += count;
+}
+
 void bit_buffer::clear() {
     if (buffer_memory != nullptr) {
         free(buffer_memory);
         buffer_memory = nullptr;
     }
-    size = allocated_size = 0;
+    size = allocated_size = position = 0;
 }
 
 void bit_buffer::write_byte(byte b) {
@@ -114,8 +177,8 @@ void bit_buffer::write_byte(byte b) {
 }
 
 bit bit_buffer::get_bit() const {
-    int byte_pos = position / 8;
-    int bit_pos = position % 8;
+    int64_t byte_pos = position / 8;
+    int bit_pos = (int) (position % 8);
     return (bit) (((buffer_memory[byte_pos]) >> bit_pos) & 1);
 }
 
@@ -136,16 +199,65 @@ byte bit_buffer::next_byte() {
     return  b;
 }
 
+// count bits (count <= 64) from bit from, bits past the end are zeros
+uint64_t bit_buffer::load_bits(int64_t from, int count) const {
+    if (count == 0 || from >= size) {
+        return 0;
+    }
+    int64_t index = from / 8;
+    int offset = (int) (from % 8);
+    uint64_t value = 0;
+    if (LITTLE_ENDIAN_WORDS && index + 9 <= length_bytes()) {
+        memcpy(&value, buffer_memory + index, 8);
+        value >>= offset;
+        if (offset + count > 64) {
+            value |= (uint64_t) buffer_memory[index + 8] << (64 - offset);
+        }
+    } else {
+        int bytes = (offset + count + 7) / 8;
+        for (int i = 0; i < bytes && index + i < length_bytes(); i++) {
+            uint64_t b = buffer_memory[index + i];
+            value |= i == 0 ? b >> offset : b << (i * 8 - offset);
+        }
+    }
+    if (from + count > size) {
+        count = (int) (size - from);
+    }
+    return value & low_mask(count);
+}
+
+uint64_t bit_buffer::peek_bits(int count) const {
+    return load_bits(position, count);
+}
+
+uint64_t bit_buffer::read_bits(int count) {
+    uint64_t value = load_bits(position, count);
+    position += count;
+    return value;
+}
+
+void bit_buffer::skip_bits(int64_t count) {
+    position += count;
+}
+
 void bit_buffer::rewind() {
     position = 0;
 }
 
+int64_t bit_buffer::get_position() const {
+    return position;
+}
+
+void bit_buffer::seek(int64_t position) {
+    this->position = position;
+}
+
 void bit_buffer::print() const {
     if (buffer_memory == nullptr) {
         return;
     }
 
-    for (int i = 0; i < size / 8; i++) {
+    for (int64_t i = 0; i < size / 8; i++) {
         byte b = buffer_memory[i];
         for (int j = 0; j < 8; j++) {
             std::cout << ((b >> j) & 1);
@@ -153,12 +265,22 @@ void bit_buffer::print() const {
     }
     if (size % 8 != 0) {
         byte last = buffer_memory[size / 8];
-        for (int j = 0; j < size % 8; j++) {
+        for (int j = 0; j < (int) (size % 8); j++) {
             std::cout << ((last >> j) & 1);
         }
     }
 }
 
+// bit_buffer::reader
+
+bit_buffer::reader::reader(bit_buffer const& buffer) : reader(buffer, buffer.position) {}
+
+bit_buffer::reader::reader(bit_buffer const& buffer, int64_t position) : data(buffer.buffer_memory), byte_length(buffer.length_bytes()) {
+    next_byte = position / 8;
+    refill();
+    consume((int) (position % 8));
+}
+
 bit_buffer::~bit_buffer() {
     clear();
 }
\ No newline at end of file
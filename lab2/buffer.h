@@ -1,5 +1,7 @@
 
 #include <string>
+#include <stdint.h>
+#include <string.h>
 #include "array.h"
 
 
@@ -9,35 +11,140 @@
 typedef unsigned char byte;
 typedef unsigned char bit;
 
+/*
+ * sizes and positions are 64-bit bit counts, so buffers may grow past 256 MB (2^31 bits).
+ * Bits are stored from the lowest bit of each byte, bulk calls take and return the first bit
+ * in the lowest bit of value.
+ */
 class bit_buffer {
     byte* buffer_memory = nullptr;
-    int size = 0;
-    int allocated_size = 0;
-    int position = 0;
+    int64_t size = 0; // bits
+    int64_t allocated_size = 0; // bytes
+    int64_t position = 0; // bits
 
-    void ensure_size(int size);
+    void ensure_size(int64_t size);
+    uint64_t load_bits(int64_t from, int count) const;
 public:
+    /*
+     * sequential reader keeping up to 64 upcoming bits in a register, refill() loads whole
+     * words, so one refill serves several peek/consume calls. Reads past the end return zeros.
+     * Reader does not move position of the buffer, use seek(reader.position()) for that.
+     */
+    class reader {
+        byte const* data;
+        int64_t byte_length;
+        int64_t next_byte;
+        uint64_t window = 0;
+        int count = 0;
+
+    public:
+        reader(bit_buffer const& buffer);
+        reader(bit_buffer const& buffer, int64_t position); // position in bits
+
+        // fills window to at least 57 bits, inline as decoders call it in their inner loop
+        void refill() {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            if (next_byte + 8 <= byte_length) {
+                uint64_t word;
+                memcpy(&word, data + next_byte, 8);
+                window |= word << count;
+                next_byte += (63 - count) >> 3;
+                count |= 56;
+                return;
+            }
+#endif
+            while (count <= 56) {
+                uint64_t b = next_byte < byte_length ? data[next_byte] : 0;
+                window |= b << count;
+                next_byte++;
+                count += 8;
+            }
+        }
+
+        int available() const {
+            return count;
+        }
+
+        // count <= available()
+        uint64_t peek(int count) const {
+            return window & (count >= 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1);
+        }
+
+        void consume(int count) {
+            window = count >= 64 ? 0 : window >> count;
+            this->count -= count;
+        }
+
+        // count <= 57, refills when needed
+        uint64_t read(int count) {
+            if (this->count < count) {
+                refill();
+            }
+            uint64_t value = peek(count);
+            consume(count);
+            return value;
+        }
+
+        int64_t position() const {
+            return next_byte * 8 - count;
+        }
+    };
+
+    // collects bits in a 64-bit word and appends it to buffer whole, call flush() when done
+    class writer {
+        bit_buffer& buffer;
+        uint64_t word = 0;
+        int count = 0;
+
+    public:
+        writer(bit_buffer& buffer) : buffer(buffer) {}
+
+        // low bits (bits < 64) of value, value must have no other bits set
+        void write(uint64_t value, int bits) {
+            word |= value << count;
+            count += bits;
+            if (count >= 64) {
+                buffer.write_bits(word, 64);
+                count -= 64;
+                word = value >> (bits - count);
+            }
+        }
+
+        void flush() {
+            buffer.write_bits(word, count);
+            word = 0;
+            count = 0;
+        }
+    };
 
     bit_buffer();
     bit_buffer(bit_buffer const& other);
     bit_buffer(bit_buffer&& other);
     bit_buffer(array<bit> const&);
+    bit_buffer(bit const* bits, int64_t count);
     bit_buffer& operator=(bit_buffer const&);
     bit_buffer& operator=(bit_buffer&&);
 
-    int length_bytes() const;
-    int length_bits() const;
+    int64_t length_bytes() const;
+    int64_t length_bits() const;
     byte* get_buffer() const;
-    void write_bytes(byte const *buffer, int size);
+    void write_bytes(byte const *buffer, int64_t size);
+    void reserve(int64_t bits);
 
     void write_byte(byte b);
     void write_bit(bit b);
+    void write_bits(uint64_t value, int count);
 
     bit get_bit() const;
     byte get_byte() const;
     bit next_bit();
     byte next_byte();
+    uint64_t peek_bits(int count) const;
+    uint64_t read_bits(int count);
+    void skip_bits(int64_t count);
     void rewind();
+    int64_t get_position() const;
+    void seek(int64_t position);
 
     void clear();
     void print() const;
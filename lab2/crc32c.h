@@ -0,0 +1,76 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_HARDWARE 1
+#endif
+
+
+#ifndef M_CRC32C_H
+#define M_CRC32C_H
+
+/*
+ * CRC32C (Castagnoli, reflected polynomial 0x82F63B78). On x86-64 the SSE4.2 crc32 instruction
+ * is used when the CPU has it (checked at run time, so the build needs no -msse4.2), otherwise
+ * bytes go through a 256-entry table. crc32c(data, size, crc32c(prefix)) continues a checksum.
+ */
+namespace crc32c_detail {
+    struct table {
+        uint32_t entries[256];
+
+        table() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+                }
+                entries[i] = crc;
+            }
+        }
+    };
+
+    inline uint32_t software(uint32_t crc, unsigned char const* data, size_t size) {
+        static const table crc_table;
+        for (size_t i = 0; i < size; i++) {
+            crc = crc_table.entries[(crc ^ data[i]) & 255] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+#ifdef CRC32C_HARDWARE
+    __attribute__((target("sse4.2")))
+    inline uint32_t hardware(uint32_t crc, unsigned char const* data, size_t size) {
+        uint64_t crc64 = crc;
+        for (; size >= 8; size -= 8, data += 8) {
+            uint64_t word;
+            memcpy(&word, data, 8);
+            crc64 = _mm_crc32_u64(crc64, word);
+        }
+        crc = (uint32_t) crc64;
+        for (; size > 0; size--, data++) {
+            crc = _mm_crc32_u8(crc, *data);
+        }
+        return crc;
+    }
+
+    inline bool has_hardware() {
+        static const bool supported = __builtin_cpu_supports("sse4.2");
+        return supported;
+    }
+#endif
+}
+
+inline uint32_t crc32c(void const* data, size_t size, uint32_t previous = 0) {
+    uint32_t crc = ~previous;
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+#ifdef CRC32C_HARDWARE
+    if (crc32c_detail::has_hardware()) {
+        return ~crc32c_detail::hardware(crc, bytes, size);
+    }
+#endif
+    return ~crc32c_detail::software(crc, bytes, size);
+}
+
+#endif
@@ -1,8 +1,16 @@
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+
 #include "huffman.h"
+#include "parallel.h"
+#include "crc32c.h"
 
 
 void print_readable_character(char c) {
-    if (c == '\n') {
+    if (c == '\0') {
+        std::cout << "'\\0'";
+    } else if (c == '\n') {
         std::cout << "'\\n'";
     } else if (c == '\t') {
         std::cout << "'\\t'";
@@ -11,11 +19,13 @@ void print_readable_character(char c) {
     }
 }
 
-void print_readable_characters(array<char> const& chars) {
+void print_readable_characters(huffman_tree::node_characters const& chars) {
     std::cout << "'";
     for (int i = 0; i < chars.length(); i++) {
         char c = chars[i];
-        if (c == '\n') {
+        if (c == '\0') {
+            std::cout << "\\0";
+        } else if (c == '\n') {
             std::cout << "\\n";
         } else if (c == '\t') {
             std::cout << "\\t";
@@ -29,22 +39,14 @@ void print_readable_characters(array<char> const& chars) {
 
 // huffman_tree::tree_node
 
-void huffman_tree::tree_node::build_codes(rb_map<char, bit_buffer> &code_map, array<bit> &code) {
-    if (character != 0) {
-        code_map[character] = code;
-    }
-
-    int code_length = code.length();
-    if (left != nullptr) {
-        code.add(0);
-        left->build_codes(code_map, code);
-        code.resize(code_length);
-    }
-    if (right != nullptr) {
-        code.add(1);
-        right->build_codes(code_map, code);
-        code.resize(code_length);
+void huffman_tree::tree_node::build_lengths(code_entry* codes, int depth) {
+    if (leaf) {
+        // single symbol still needs one bit to be canonical
+        codes[(unsigned char) character].length = depth > 0 ? depth : 1;
+        return;
     }
+    left->build_lengths(codes, depth + 1);
+    right->build_lengths(codes, depth + 1);
 }
 
 huffman_tree::tree_node::~tree_node() {
@@ -52,6 +54,15 @@ huffman_tree::tree_node::~tree_node() {
     delete(right);
 }
 
+void huffman_tree::tree_node::collect_characters(node_characters &chars) {
+    if (leaf) {
+        chars.add(character);
+        return;
+    }
+    left->collect_characters(chars);
+    right->collect_characters(chars);
+}
+
 void huffman_tree::tree_node::print_tree(int depth) {
     if (left != nullptr) {
         left->print_tree(depth + 1);
@@ -59,6 +70,8 @@ void huffman_tree::tree_node::print_tree(int depth) {
     for (int i = 0; i < depth; i++) {
         std::cout << "    ";
     }
+    node_characters characters;
+    collect_characters(characters);
     print_readable_characters(characters);
     std::cout << " weight=" << weight << "\n";
 
@@ -67,36 +80,40 @@ void huffman_tree::tree_node::print_tree(int depth) {
     }
 }
 
-huffman_tree::tree_node* huffman_tree::build_tree_from_nodes(list<huffman_tree::tree_node*> &nodes) {
-    if (nodes.get_length() == 0) {
+/*
+ * two-queue construction: leaves sorted by weight form the first queue, merged nodes are
+ * created in non-decreasing weight order and form the second one, so both minimums are
+ * always at queue fronts and the whole build after sorting is O(n)
+ */
+huffman_tree::tree_node* huffman_tree::build_tree_from_nodes(array<huffman_tree::tree_node*> &leaves) {
+    if (leaves.length() == 0) {
         return nullptr;
     }
-    while (nodes.get_length() > 1) {
-        auto min_node_it1 = nodes.end();
-        auto min_node_it2 = nodes.end();
-        for (auto i = nodes.begin(); i != nodes.end(); i++) {
-            tree_node* node = *i;
-            if (min_node_it1 == nodes.end() || (*min_node_it1)->weight > node->weight) {
-                min_node_it2 = min_node_it1;
-                min_node_it1 = i;
-            } else if (min_node_it2 == nodes.end() || (*min_node_it2)->weight > node->weight) {
-                min_node_it2 = i;
-            }
+    stable_sort(leaves, [] (tree_node* a, tree_node* b) -> bool {
+        return a->weight < b->weight;
+    }, 1);
+
+    array<tree_node*> merged;
+    merged.reserve(leaves.length());
+    int64_t next_leaf = 0;
+    int64_t next_merged = 0;
+    auto take_min = [&] () -> tree_node* {
+        if (next_merged == merged.length() ||
+            (next_leaf < leaves.length() && leaves[next_leaf]->weight <= merged[next_merged]->weight)) {
+            return leaves[next_leaf++];
         }
-        tree_node* node1 = *min_node_it1;
-        tree_node* node2 = *min_node_it2;
-        nodes.erase(min_node_it1);
-        nodes.erase(min_node_it2);
+        return merged[next_merged++];
+    };
 
-        tree_node* new_node = *nodes.add(new tree_node());
-        new_node->characters.add_all(node1->characters);
-        new_node->characters.add_all(node2->characters);
+    for (int64_t merges = leaves.length() - 1; merges > 0; merges--) {
+        tree_node* node1 = take_min();
+        tree_node* node2 = take_min();
+        tree_node* new_node = merged.add(new tree_node());
         new_node->weight = node1->weight + node2->weight;
         new_node->left = node1;
         new_node->right = node2;
     }
-
-    return *nodes.begin();
+    return merged.length() > 0 ? merged[merged.length() - 1] : leaves[0];
 }
 
 
@@ -105,120 +122,443 @@ huffman_tree::tree_node* huffman_tree::build_tree_from_nodes(list<huffman_tree::
 huffman_tree::char_weights::char_weights() = default;
 
 huffman_tree::char_weights::char_weights(const huffman_tree::char_weights &other) {
-    memcpy(weights, other.weights, sizeof(int) * 256);
+    memcpy(weights, other.weights, sizeof(weights));
 }
 
-huffman_tree::char_weights::char_weights(std::string const &string) {
-    for (char c : string) {
-        weights[(unsigned char) c]++;
+huffman_tree::char_weights::char_weights(std::string const &string) : char_weights(string.data(), (int64_t) string.size()) {}
+
+/*
+ * histogram over four sub-tables, so runs of the same byte increment different counters instead
+ * of waiting on the previous store to the same one. Input is read by 64-bit words, inputs over
+ * PARALLEL_HISTOGRAM_SIZE are split between hardware threads with own tables
+ */
+static const int64_t PARALLEL_HISTOGRAM_SIZE = 4 << 20;
+
+static void count_bytes(char const *data, int64_t length, int64_t *weights) {
+    int64_t tables[4][256] = {{0}};
+    int64_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        uint64_t word1, word2;
+        memcpy(&word1, data + i, 8);
+        memcpy(&word2, data + i + 8, 8);
+        for (int shift = 0; shift < 64; shift += 16) {
+            tables[0][(word1 >> shift) & 0xFF]++;
+            tables[1][(word1 >> (shift + 8)) & 0xFF]++;
+            tables[2][(word2 >> shift) & 0xFF]++;
+            tables[3][(word2 >> (shift + 8)) & 0xFF]++;
+        }
+    }
+    for (; i < length; i++) {
+        tables[0][(unsigned char) data[i]]++;
+    }
+    for (int c = 0; c < 256; c++) {
+        weights[c] += tables[0][c] + tables[1][c] + tables[2][c] + tables[3][c];
     }
 }
 
-void huffman_tree::char_weights::read(bit_buffer &buffer) {
-    for (int i = 0; i < 256; i++) {
-        weights[i] = (buffer.next_byte() << 24) | (buffer.next_byte() << 16) | (buffer.next_byte() << 8) | buffer.next_byte();
+huffman_tree::char_weights::char_weights(char const *data, int64_t length) {
+    int threads = resolve_thread_count(0);
+    if (length < PARALLEL_HISTOGRAM_SIZE || threads == 1) {
+        count_bytes(data, length, weights);
+        return;
+    }
+    array<char_weights> partial(threads);
+    run_parallel(threads, [&] (int thread) -> void {
+        int64_t begin = length * thread / threads;
+        int64_t end = length * (thread + 1) / threads;
+        count_bytes(data + begin, end - begin, partial[thread].weights);
+    });
+    for (int t = 0; t < threads; t++) {
+        for (int c = 0; c < 256; c++) {
+            weights[c] += partial[t].weights[c];
+        }
     }
 }
 
-void huffman_tree::char_weights::write(bit_buffer &buffer) {
-    for (int i = 0; i < 256; i++) {
-        int w = weights[i];
-        buffer.write_byte(byte((w >> 24) & 0xFF));
-        buffer.write_byte(byte((w >> 16) & 0xFF));
-        buffer.write_byte(byte((w >> 8) & 0xFF));
-        buffer.write_byte(byte(w & 0xFF));
+// big-endian 64-bit integers for lengths of inputs over 4 GB
+static void write_int64(bit_buffer &buffer, uint64_t value) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        buffer.write_byte(byte((value >> shift) & 0xFF));
     }
 }
 
-huffman_tree::char_weights::char_weights(bit_buffer &buffer) {
-    read(buffer);
+static uint64_t read_int64(bit_buffer &buffer) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | buffer.next_byte();
+    }
+    return value;
 }
 
-
 // huffman_tree
 
-huffman_tree::huffman_tree(const huffman_tree::char_weights &weights) : weights(weights) {
-    list<tree_node*> nodes;
+huffman_tree::huffman_tree(const huffman_tree::char_weights &weights, int max_code_length) : weights(weights) {
+    array<tree_node*> leaves;
     for (int i = 0; i < 256; i++) {
         if (weights.weights[i] > 0) {
-            tree_node* new_node = *nodes.add(new tree_node());
+            tree_node* new_node = leaves.add(new tree_node());
             new_node->weight = weights.weights[i];
+            new_node->leaf = true;
             new_node->character = char(i);
-            new_node->characters.add(new_node->character);
         }
     }
 
-    root = build_tree_from_nodes(nodes);
+    int symbol_count = (int) leaves.length();
+    root = build_tree_from_nodes(leaves);
     if (root != nullptr) {
-        array<bit> code;
-        root->build_codes(char_codes, code);
+        root->build_lengths(char_codes, 0);
+        int longest = 0;
+        for (int i = 0; i < 256; i++) {
+            longest = char_codes[i].length > longest ? char_codes[i].length : longest;
+        }
+        // limit can't be below ceil(log2(symbol count))
+        int min_length = 1;
+        while ((1 << min_length) < symbol_count) {
+            min_length++;
+        }
+        max_code_length = max_code_length < min_length ? min_length : max_code_length;
+        if (longest > max_code_length) {
+            limit_code_lengths(max_code_length);
+        }
+        build_canonical_codes();
     }
 }
 
-void huffman_tree::print_codes() {
-    list<char>& keys = char_codes.keys();
-    for (auto i = keys.begin(); i != keys.end(); i++) {
-        std::cout << "code for ";
-        print_readable_character(*i);
-        std::cout << ": ";
-        char_codes[*i].print();
-        std::cout << "\n";
+/*
+ * package-merge: level 0 is the list of symbols sorted by weight, every next level merges
+ * symbols with packages made of neighbouring pairs of previous level. Taking first 2n - 2
+ * items of the last level gives optimal lengths: each symbol gets one bit for every level
+ * where it is selected, and p selected packages select first 2p items of level below.
+ */
+void huffman_tree::limit_code_lengths(int max_length) {
+    struct item {
+        int64_t weight;
+        int symbol; // -1 for package
+    };
+
+    array<item> symbols;
+    for (int i = 0; i < 256; i++) {
+        if (weights.weights[i] > 0) {
+            symbols.add(item{weights.weights[i], i});
+        }
+        char_codes[i].length = 0;
+    }
+    stable_sort(symbols, [] (item const& a, item const& b) -> bool {
+        return a.weight < b.weight;
+    }, 1);
+
+    array<array<item>> levels;
+    levels.add(symbols);
+    for (int level = 1; level < max_length; level++) {
+        array<item> const& previous = levels[level - 1];
+        array<item> current;
+        current.reserve(symbols.length() + previous.length() / 2);
+        int64_t next_symbol = 0;
+        int64_t next_pair = 0;
+        while (next_symbol < symbols.length() || next_pair + 1 < previous.length()) {
+            bool take_symbol = next_pair + 1 >= previous.length() || (next_symbol < symbols.length() &&
+                    symbols[next_symbol].weight <= previous[next_pair].weight + previous[next_pair + 1].weight);
+            if (take_symbol) {
+                current.add(symbols[next_symbol++]);
+            } else {
+                current.add(item{previous[next_pair].weight + previous[next_pair + 1].weight, -1});
+                next_pair += 2;
+            }
+        }
+        levels.add(std::move(current));
+    }
+
+    int64_t selected = 2 * symbols.length() - 2;
+    for (int64_t level = levels.length() - 1; level >= 0 && selected > 0; level--) {
+        int64_t packages = 0;
+        for (int64_t i = 0; i < selected; i++) {
+            item const& it = levels[level][i];
+            if (it.symbol >= 0) {
+                char_codes[it.symbol].length++;
+            } else {
+                packages++;
+            }
+        }
+        selected = packages * 2;
     }
 }
 
+/*
+ * header is a run-length list of code lengths for all 256 symbols: 6-bit length, 1 bit flag
+ * and, if flag is set, 8-bit count - 2 of following symbols with the same length
+ */
+static const int HEADER_LENGTH_BITS = 6;
+
+huffman_tree::huffman_tree(bit_buffer &buffer) {
+    bit_buffer::reader input(buffer);
+    read_lengths(input);
+    buffer.seek(input.position());
+}
+
+huffman_tree::huffman_tree(bit_buffer::reader &input) {
+    read_lengths(input);
+}
+
+void huffman_tree::read_lengths(bit_buffer::reader &input) {
+    for (int i = 0; i < 256;) {
+        int length = (int) input.read(HEADER_LENGTH_BITS);
+        int count = input.read(1) ? (int) input.read(8) + 2 : 1;
+        for (int j = 0; j < count && i < 256; j++, i++) {
+            char_codes[i].length = length;
+        }
+    }
+    build_canonical_codes();
+}
+
 void huffman_tree::write(bit_buffer &buffer) {
-    weights.write(buffer);
+    for (int i = 0; i < 256;) {
+        int length = char_codes[i].length;
+        int count = 1;
+        while (i + count < 256 && count < 257 && char_codes[i + count].length == length) {
+            count++;
+        }
+        buffer.write_bits((uint64_t) length, HEADER_LENGTH_BITS);
+        if (count == 1) {
+            buffer.write_bits(0, 1);
+        } else {
+            buffer.write_bits(1, 1);
+            buffer.write_bits((uint64_t) (count - 2), 8);
+        }
+        i += count;
+    }
 }
 
-void huffman_tree::encode_string(std::string const &str, bit_buffer &buff) {
-    unsigned int length = (unsigned int) str.length();
-    buff.write_byte((byte) ((length >> 24) & 0xFF));
-    buff.write_byte((byte) ((length >> 16) & 0xFF));
-    buff.write_byte((byte) ((length >> 8) & 0xFF));
-    buff.write_byte((byte) ((length >> 0) & 0xFF));
+// assigns codes from lengths: shorter codes first, same length in symbol order
+void huffman_tree::build_canonical_codes() {
+    for (int i = 0; i < 256; i++) {
+        length_count[char_codes[i].length]++;
+    }
+    length_count[0] = 0;
+    for (int length = 1, offset = 0; length <= MAX_CODE_LENGTH; length++) {
+        length_offset[length] = offset;
+        offset += length_count[length];
+        first_code[length] = (first_code[length - 1] + (uint64_t) length_count[length - 1]) << 1;
+    }
+
+    int next_index[MAX_CODE_LENGTH + 1];
+    memcpy(next_index, length_offset, sizeof(next_index));
+    decode_table.resize(1 << DECODE_TABLE_BITS);
+    for (int i = 0; i < 256; i++) {
+        int length = char_codes[i].length;
+        if (length == 0) {
+            continue;
+        }
+        int index = next_index[length]++;
+        sorted_symbols[index] = (unsigned char) i;
+        uint64_t code = first_code[length] + (uint64_t) (index - length_offset[length]);
+
+        // canonical code is sent from its highest bit, reverse it for lowest-first bit stream
+        uint64_t bits = 0;
+        for (int j = 0; j < length; j++) {
+            bits |= ((code >> (length - 1 - j)) & 1) << j;
+        }
+        char_codes[i].bits = bits;
+
+        // every table prefix starting with this code
+        if (length <= DECODE_TABLE_BITS) {
+            for (uint32_t prefix = (uint32_t) bits; prefix < (uint32_t) decode_table.length(); prefix += uint32_t(1) << length) {
+                decode_table[prefix].symbol = (unsigned char) i;
+                decode_table[prefix].length = (unsigned char) length;
+            }
+        }
+    }
+}
 
-    const char* c_str = str.data();
-    for (int i = 0; c_str[i]; i++) {
-        bit_buffer& code = char_codes[c_str[i]];
-        code.rewind();
-        for (int j = 0; j < code.length_bits(); j++) {
-            buff.write_bit(code.next_bit());
+char huffman_tree::decode_long_code(bit_buffer::reader &input) {
+    uint64_t code = 0;
+    for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+        code = (code << 1) | input.read(1);
+        if (code - first_code[length] < (uint64_t) length_count[length]) {
+            return (char) sorted_symbols[length_offset[length] + (int) (code - first_code[length])];
         }
     }
+    return 0; // corrupted input
+}
+
+void huffman_tree::print_codes() {
+    for (int i = 0; i < 256; i++) {
+        if (weights.weights[i] > 0) {
+            std::cout << "code for ";
+            print_readable_character(char(i));
+            std::cout << ": ";
+            for (int j = 0; j < char_codes[i].length; j++) {
+                std::cout << ((char_codes[i].bits >> j) & 1);
+            }
+            std::cout << "\n";
+        }
+    }
+}
+
+void huffman_tree::encode_string(std::string const &str, bit_buffer &buff) {
+    encode_bytes((uint8_t const*) str.data(), str.length(), buff);
 }
 
 std::string huffman_tree::decode_string(bit_buffer &buff) {
-    bit_buffer output_string;
-    unsigned int length = ((unsigned int) buff.next_byte() << 24) | ((unsigned int) buff.next_byte() << 16) | ((unsigned int) buff.next_byte() << 8) | (unsigned int) buff.next_byte();
-    for (int i = 0; i < length; i++) {
-        tree_node* node = root;
-        while (node->character == 0) {
-            if (buff.next_bit()) {
-                node = node->right;
-            } else {
-                node = node->left;
+    uint64_t length = read_int64(buff);
+    std::string output(length, '\0');
+
+    bit_buffer::reader input(buff);
+    decode_symbols(input, &output[0], (int64_t) length);
+    buff.seek(input.position());
+    return output;
+}
+
+void huffman_tree::encode_bytes(uint8_t const *data, size_t length, bit_buffer &buff) {
+    write_int64(buff, (uint64_t) length);
+    encode_symbols((char const*) data, (int64_t) length, buff);
+}
+
+size_t huffman_tree::decode_bytes(bit_buffer &buff, uint8_t *out, size_t capacity) {
+    int64_t start = buff.get_position();
+    size_t length = (size_t) read_int64(buff);
+    if (length > capacity) {
+        buff.seek(start);
+        return length;
+    }
+
+    bit_buffer::reader input(buff);
+    decode_symbols(input, (char*) out, (int64_t) length);
+    buff.seek(input.position());
+    return length;
+}
+
+void huffman_tree::encode_symbols(char const *data, int64_t length, bit_buffer &buff) {
+    buff.reserve(buff.length_bits() + calculate_size() + 128); // word stores may touch 9 bytes past the end
+
+    bit_buffer::writer output(buff);
+    for (int64_t i = 0; i < length; i++) {
+        code_entry const& code = char_codes[(unsigned char) data[i]];
+        output.write(code.bits, code.length);
+    }
+    output.flush();
+}
+
+char huffman_tree::decode_symbol(bit_buffer::reader &input) {
+    if (input.available() < DECODE_TABLE_BITS) {
+        input.refill();
+    }
+    decode_entry const& entry = decode_table[input.peek(DECODE_TABLE_BITS)];
+    if (entry.length > 0) {
+        input.consume(entry.length);
+        return (char) entry.symbol;
+    }
+    return decode_long_code(input);
+}
+
+void huffman_tree::decode_symbols(bit_buffer::reader &input, char *out, int64_t length) {
+    for (int64_t i = 0; i < length; i++) {
+        out[i] = decode_symbol(input);
+    }
+}
+
+int64_t huffman_tree::decode_symbols_before(bit_buffer::reader &input, int64_t end_position, char *out, int64_t length) {
+    int64_t i = 0;
+    while (i < length && input.position() <= end_position) {
+        out[i++] = decode_symbol(input);
+    }
+    return i;
+}
+
+void huffman_tree::encode_interleaved(char const *data, int64_t length, bit_buffer &buff) {
+    bit_buffer streams[INTERLEAVED_STREAMS];
+    for (int s = 0; s < INTERLEAVED_STREAMS; s++) {
+        streams[s].reserve(calculate_size() / INTERLEAVED_STREAMS + 1024);
+        bit_buffer::writer output(streams[s]);
+        for (int64_t i = s; i < length; i += INTERLEAVED_STREAMS) {
+            code_entry const& code = char_codes[(unsigned char) data[i]];
+            output.write(code.bits, code.length);
+        }
+        output.flush();
+    }
+    for (int s = 0; s < INTERLEAVED_STREAMS - 1; s++) {
+        write_int64(buff, (uint64_t) streams[s].length_bytes());
+    }
+    for (int s = 0; s < INTERLEAVED_STREAMS; s++) {
+        buff.write_bytes(streams[s].get_buffer(), streams[s].length_bytes());
+    }
+}
+
+void huffman_tree::decode_interleaved(bit_buffer const &buff, int64_t position, char *out, int64_t length) {
+    static_assert(INTERLEAVED_STREAMS == 4, "decoding loop is unrolled for four sub-streams");
+
+    // sizes start at next byte boundary
+    bit_buffer::reader sizes(buff, (position + 7) / 8 * 8);
+    int64_t starts[INTERLEAVED_STREAMS];
+    starts[0] = (position + 7) / 8 + (INTERLEAVED_STREAMS - 1) * 8;
+    if (starts[0] > buff.length_bytes()) {
+        starts[0] = buff.length_bytes();
+    }
+    for (int s = 1; s < INTERLEAVED_STREAMS; s++) {
+        uint64_t size = 0;
+        for (int i = 0; i < 8; i++) {
+            size = (size << 8) | sizes.read(8);
+        }
+        // corrupt sizes must not move readers outside of the buffer
+        int64_t left = buff.length_bytes() - starts[s - 1];
+        starts[s] = left > 0 && size < (uint64_t) left ? starts[s - 1] + (int64_t) size : buff.length_bytes();
+    }
+    bit_buffer::reader inputs[INTERLEAVED_STREAMS] = {
+        bit_buffer::reader(buff, starts[0] * 8), bit_buffer::reader(buff, starts[1] * 8),
+        bit_buffer::reader(buff, starts[2] * 8), bit_buffer::reader(buff, starts[3] * 8)
+    };
+
+    // four independent dependency chains; one refill leaves at least 57 bits, enough for four
+    // table lookups of up to 11 bits, long codes refill by themselves
+    int64_t i = 0;
+    const int STEP = INTERLEAVED_STREAMS * 4;
+    for (; i + STEP <= length; i += STEP) {
+        for (int s = 0; s < INTERLEAVED_STREAMS; s++) {
+            inputs[s].refill();
+        }
+        for (int k = 0; k < STEP; k += INTERLEAVED_STREAMS) {
+            for (int s = 0; s < INTERLEAVED_STREAMS; s++) {
+                decode_entry const& entry = decode_table[inputs[s].peek(DECODE_TABLE_BITS)];
+                if (entry.length > 0) {
+                    inputs[s].consume(entry.length);
+                    out[i + k + s] = (char) entry.symbol;
+                } else {
+                    out[i + k + s] = decode_long_code(inputs[s]);
+                    inputs[s].refill();
+                }
             }
         }
-        output_string.write_byte(node->character);
     }
-    output_string.write_byte(0);
-    return std::string((char*) output_string.get_buffer());
+    for (; i < length; i++) {
+        out[i] = decode_symbol(inputs[i % INTERLEAVED_STREAMS]);
+    }
 }
 
 void huffman_tree::print_tree() {
-    root->print_tree();
+    if (root != nullptr) {
+        root->print_tree();
+    }
 }
 
 huffman_tree::~huffman_tree() {
     delete(root);
 }
 
-int huffman_tree::calculate_size() {
-    int size = 0;
+int huffman_tree::get_code_length(char c) const {
+    return char_codes[(unsigned char) c].length;
+}
+
+int huffman_tree::get_max_code_length() const {
+    int longest = 0;
+    for (int i = 0; i < 256; i++) {
+        longest = char_codes[i].length > longest ? char_codes[i].length : longest;
+    }
+    return longest;
+}
+
+int64_t huffman_tree::calculate_size() {
+    int64_t size = 0;
     for (int i = 0 ; i < 256; i++) {
-        if (char_codes.has(char(i))) {
-            size += weights.weights[i] * char_codes[char(i)].length_bits();
-        }
+        size += weights.weights[i] * char_codes[i].length;
     }
     return size;
 }
@@ -226,15 +566,21 @@ int huffman_tree::calculate_size() {
 
 // huffman_codec
 
-bit_buffer huffman_codec::encode(std::string const &str, bool print_stats) {
-    int str_size = (int) str.size() * 8;
+bit_buffer huffman_codec::encode(std::string const &str, bool print_stats, int max_code_length) {
+    return encode((uint8_t const*) str.data(), str.size(), print_stats, max_code_length);
+}
+
+bit_buffer huffman_codec::encode(uint8_t const *data, size_t length, bool print_stats, int max_code_length) {
+    int64_t str_size = (int64_t) length * 8;
     if (print_stats) {
-        std::cout << "encoder input: " << str << "\n";
+        std::cout << "encoder input: ";
+        std::cout.write((char const*) data, (std::streamsize) length);
+        std::cout << "\n";
         std::cout << "input size (bits): " << str_size << "\n";
     }
 
     bit_buffer buffer;
-    if (str.empty()) {
+    if (length == 0) {
         buffer.write_bit(0);
         if (print_stats) {
             std::cout << "input is empty" << "\n";
@@ -244,7 +590,7 @@ bit_buffer huffman_codec::encode(std::string const &str, bool print_stats) {
         buffer.write_bit(1);
     }
 
-    huffman_tree tree(str);
+    huffman_tree tree(huffman_tree::char_weights((char const*) data, (int64_t) length), max_code_length);
     if (print_stats) {
         std::cout << "huffman tree: \n";
         tree.print_tree();
@@ -252,16 +598,16 @@ bit_buffer huffman_codec::encode(std::string const &str, bool print_stats) {
         std::cout << "character codes: \n";
         tree.print_codes();
         std::cout << "\n";
-        int calc_size = tree.calculate_size();
+        int64_t calc_size = tree.calculate_size();
         std::cout << "theory size (without dictionary): " << calc_size << " " << (calc_size / (double) str_size) * 100 << "%\n";
     }
 
     tree.write(buffer);
     if (print_stats) {
-        std::cout << "leading byte (8) + dictionary size (256 * int32 = 8192): " << buffer.length_bits() << "\n";
+        std::cout << "leading bit + code lengths header: " << buffer.length_bits() << "\n";
     }
 
-    tree.encode_string(str, buffer);
+    tree.encode_bytes(data, length, buffer);
     if (print_stats) {
         std::cout << "total size: " << buffer.length_bits() << " " << (buffer.length_bits() / (double) str_size) * 100 << "%\n";
     }
@@ -277,3 +623,475 @@ std::string huffman_codec::decode(bit_buffer &buffer) {
     huffman_tree tree(buffer);
     return tree.decode_string(buffer);
 }
+
+size_t huffman_codec::decode(bit_buffer &buffer, uint8_t *out, size_t capacity) {
+    buffer.rewind();
+    if (!buffer.next_bit()) {
+        return 0;
+    }
+    huffman_tree tree(buffer);
+    return tree.decode_bytes(buffer, out, capacity);
+}
+
+
+bit_buffer huffman_codec::encode_blocks(std::string const &str, int64_t block_size, int threads, bool interleaved) {
+    if (block_size <= 0 || block_size > MAX_STREAM_BLOCK_SIZE) {
+        throw std::invalid_argument("huffman_codec::encode_blocks: block size out of range");
+    }
+    int64_t length = (int64_t) str.size();
+    int64_t block_count = (length + block_size - 1) / block_size;
+    threads = resolve_thread_count(threads);
+    threads = threads < block_count ? threads : (int) (block_count > 0 ? block_count : 1);
+
+    array<bit_buffer> blocks(block_count);
+    run_parallel(threads, [&] (int thread) -> void {
+        for (int64_t i = thread; i < block_count; i += threads) {
+            char const* data = str.data() + i * block_size;
+            int64_t size = length - i * block_size < block_size ? length - i * block_size : block_size;
+            huffman_tree tree(huffman_tree::char_weights(data, size));
+            tree.write(blocks[i]);
+            if (interleaved) {
+                tree.encode_interleaved(data, size, blocks[i]);
+            } else {
+                tree.encode_symbols(data, size, blocks[i]);
+            }
+        }
+    });
+
+    bit_buffer buffer;
+    write_int64(buffer, (uint64_t) length);
+    write_int64(buffer, (uint64_t) block_size);
+    write_int64(buffer, interleaved ? 1 : 0);
+    write_int64(buffer, (uint64_t) block_count);
+    int64_t offset = 0;
+    for (int64_t i = 0; i < block_count; i++) {
+        offset += blocks[i].length_bytes();
+        write_int64(buffer, (uint64_t) offset);
+    }
+    buffer.reserve(buffer.length_bits() + offset * 8);
+    for (int64_t i = 0; i < block_count; i++) {
+        buffer.write_bytes(blocks[i].get_buffer(), blocks[i].length_bytes());
+    }
+    return buffer;
+}
+
+std::string huffman_codec::decode_blocks(bit_buffer &buffer, int threads) {
+    // every field is checked against buffer size before anything is allocated or read by it
+    int64_t buffer_bytes = buffer.length_bytes();
+    if (buffer_bytes < 32) {
+        throw format_exception();
+    }
+    buffer.rewind();
+    uint64_t length = read_int64(buffer);
+    uint64_t block_size = read_int64(buffer);
+    bool interleaved = read_int64(buffer) != 0;
+    uint64_t block_count = read_int64(buffer);
+    // every symbol takes at least one bit
+    if (block_size == 0 || block_size > (uint64_t) MAX_STREAM_BLOCK_SIZE || length > (uint64_t) buffer.length_bits() ||
+        block_count != (length + block_size - 1) / block_size || block_count > (uint64_t) (buffer_bytes - 32) / 8) {
+        throw format_exception();
+    }
+
+    // end offsets in the index are relative to the first block, blocks are never empty
+    int64_t blocks_start = buffer.get_position() / 8 + (int64_t) block_count * 8;
+    array<int64_t> block_starts(block_count + 1);
+    block_starts[0] = blocks_start;
+    for (uint64_t i = 0; i < block_count; i++) {
+        uint64_t end = read_int64(buffer);
+        if (end > (uint64_t) (buffer_bytes - blocks_start) || (int64_t) end + blocks_start <= block_starts[i]) {
+            throw format_exception();
+        }
+        block_starts[i + 1] = blocks_start + (int64_t) end;
+    }
+    buffer.seek(block_starts[block_count] * 8);
+
+    std::string output(length, '\0');
+    threads = resolve_thread_count(threads);
+    threads = (uint64_t) threads < block_count ? threads : (int) (block_count > 0 ? block_count : 1);
+    run_parallel(threads, [&] (int thread) -> void {
+        for (int64_t i = thread; i < (int64_t) block_count; i += threads) {
+            int64_t size = (int64_t) (length - i * block_size < block_size ? length - i * block_size : block_size);
+            bit_buffer::reader input(buffer, block_starts[i] * 8);
+            huffman_tree tree(input);
+            if (interleaved) {
+                tree.decode_interleaved(buffer, input.position(), &output[i * block_size], size);
+            } else {
+                tree.decode_symbols(input, &output[i * block_size], size);
+            }
+        }
+    });
+    return output;
+}
+
+
+// big-endian integer of size bytes (size <= 8)
+static void write_stream_int(std::ostream &output, uint64_t value, int size = 8) {
+    char bytes[8];
+    for (int i = 0; i < size; i++) {
+        bytes[i] = char(value >> ((size - 1 - i) * 8));
+    }
+    output.write(bytes, size);
+}
+
+static bool read_stream_int(std::istream &input, uint64_t &value, int size = 8) {
+    unsigned char bytes[8];
+    if (!input.read((char*) bytes, size)) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < size; i++) {
+        value = (value << 8) | bytes[i];
+    }
+    return true;
+}
+
+// block of streaming and container formats: code lengths header and codes, padded to a byte
+static void encode_block(char const *data, int64_t length, bit_buffer &block) {
+    huffman_tree tree(huffman_tree::char_weights(data, length));
+    tree.write(block);
+    tree.encode_symbols(data, length, block);
+}
+
+// false if codes of length symbols don't fit into size bytes, reader then decoded zeros past the end
+static bool decode_block(char const *compressed, int64_t size, char *out, int64_t length) {
+    bit_buffer block;
+    block.write_bytes((byte const*) compressed, size);
+    bit_buffer::reader reader(block, 0);
+    huffman_tree tree(reader);
+    tree.decode_symbols(reader, out, length);
+    return reader.position() <= size * 8;
+}
+
+bool huffman_codec::encode_stream(std::istream &input, std::ostream &output, int64_t block_size) {
+    if (block_size <= 0 || block_size > MAX_STREAM_BLOCK_SIZE) {
+        return false;
+    }
+    write_stream_int(output, (uint64_t) block_size);
+    std::string raw(block_size, '\0');
+    while (output) {
+        input.read(&raw[0], block_size);
+        int64_t length = (int64_t) input.gcount();
+        if (length == 0) {
+            break;
+        }
+
+        bit_buffer block;
+        encode_block(raw.data(), length, block);
+        write_stream_int(output, (uint64_t) length);
+        write_stream_int(output, (uint64_t) block.length_bytes());
+        output.write((char const*) block.get_buffer(), block.length_bytes());
+    }
+    write_stream_int(output, 0);
+    return !input.bad() && (bool) output;
+}
+
+bool huffman_codec::decode_stream(std::istream &input, std::ostream &output, int64_t max_block_size) {
+    uint64_t block_size;
+    if (!read_stream_int(input, block_size) || block_size == 0 || block_size > (uint64_t) max_block_size ||
+        block_size > (uint64_t) MAX_STREAM_BLOCK_SIZE) {
+        return false;
+    }
+    std::string compressed;
+    std::string raw;
+    while (output) {
+        uint64_t length, size;
+        if (!read_stream_int(input, length)) {
+            return false;
+        }
+        if (length == 0) {
+            return true;
+        }
+        // header of 256 lengths is at most 240 bytes, codes are at most 63 bits per symbol
+        if (length > block_size || !read_stream_int(input, size) ||
+            size > length * 8 + 256) {
+            return false;
+        }
+        compressed.resize(size);
+        if (!input.read(&compressed[0], (std::streamsize) size)) {
+            return false;
+        }
+
+        raw.resize(length);
+        if (!decode_block(compressed.data(), (int64_t) size, &raw[0], (int64_t) length)) {
+            return false;
+        }
+        output.write(raw.data(), (std::streamsize) length);
+    }
+    return false;
+}
+
+
+// header of 256 code lengths takes at most 240 bytes
+static const int64_t MAX_LENGTHS_HEADER_BYTES = 256;
+
+huffman_codec::stream_decoder::stream_decoder(int64_t max_block_size) :
+    max_block_size(max_block_size < MAX_STREAM_BLOCK_SIZE ? max_block_size : MAX_STREAM_BLOCK_SIZE) {}
+
+int64_t huffman_codec::stream_decoder::push(char const *data, int64_t size) {
+    int64_t taken = 0;
+    while (taken < size) {
+        if (state == READ_BLOCK_SIZE || state == READ_LENGTH || state == READ_SIZE) {
+            field[field_bytes++] = (unsigned char) data[taken++];
+            if (field_bytes < 8) {
+                continue;
+            }
+            uint64_t value = 0;
+            for (int i = 0; i < 8; i++) {
+                value = (value << 8) | field[i];
+            }
+            field_bytes = 0;
+            if (state == READ_BLOCK_SIZE) {
+                stream_block_size = value;
+                state = value == 0 || value > (uint64_t) max_block_size ? FAILED : READ_LENGTH;
+            } else if (state == READ_LENGTH) {
+                block_length = value;
+                state = value == 0 ? FINISHED : value > stream_block_size ? FAILED : READ_SIZE;
+            } else if (value == 0 || value > block_length * 8 + 256) {
+                state = FAILED;
+            } else {
+                block_size = value;
+                start_block();
+            }
+        } else if (state == READ_HEADER || state == DECODE) {
+            int64_t missing = (int64_t) block_size - block.length_bytes();
+            if (missing == 0) {
+                break; // next block is taken after this one is pulled
+            }
+            int64_t count = size - taken < missing ? size - taken : missing;
+            block.write_bytes((byte const*) data + taken, count);
+            taken += count;
+        } else {
+            break;
+        }
+
+        int64_t header_bytes = (int64_t) block_size < MAX_LENGTHS_HEADER_BYTES ? (int64_t) block_size : MAX_LENGTHS_HEADER_BYTES;
+        if (state == READ_HEADER && block.length_bytes() >= header_bytes) {
+            bit_buffer::reader input(block, 0);
+            tree = new huffman_tree(input);
+            position = input.position();
+            state = DECODE;
+        }
+    }
+    return taken;
+}
+
+int64_t huffman_codec::stream_decoder::pull(char *out, int64_t capacity) {
+    if (state != DECODE) {
+        return 0;
+    }
+    // a code is at most MAX_CODE_LENGTH bits, so it is complete if that many bits follow its start
+    bool complete = block.length_bytes() == (int64_t) block_size;
+    int64_t end_position = complete ? block.length_bits() - 1 : block.length_bits() - huffman_tree::MAX_CODE_LENGTH;
+    int64_t length = (int64_t) block_length - decoded < capacity ? (int64_t) block_length - decoded : capacity;
+
+    bit_buffer::reader input(block, position);
+    int64_t count = tree->decode_symbols_before(input, end_position, out, length);
+    position = input.position();
+    decoded += count;
+    // codes ran past the block, or the whole block is used up with symbols still missing
+    if (position > block.length_bits()) {
+        state = FAILED;
+    } else if (decoded == (int64_t) block_length) {
+        finish_block();
+    } else if (complete && position >= block.length_bits()) {
+        state = FAILED;
+    }
+    return count;
+}
+
+void huffman_codec::stream_decoder::start_block() {
+    block.clear();
+    block.reserve((int64_t) block_size * 8);
+    decoded = 0;
+    position = 0;
+    state = READ_HEADER;
+}
+
+void huffman_codec::stream_decoder::finish_block() {
+    delete tree;
+    tree = nullptr;
+    block.clear();
+    state = READ_LENGTH;
+}
+
+bool huffman_codec::stream_decoder::finished() const {
+    return state == FINISHED;
+}
+
+bool huffman_codec::stream_decoder::failed() const {
+    return state == FAILED;
+}
+
+void huffman_codec::stream_decoder::reset() {
+    finish_block();
+    state = READ_BLOCK_SIZE;
+    field_bytes = 0;
+}
+
+huffman_codec::stream_decoder::~stream_decoder() {
+    delete tree;
+}
+
+
+static const char CONTAINER_MAGIC[4] = {'H', 'U', 'F', 'C'};
+static const int64_t CONTAINER_HEADER_SIZE = 16;
+static const int64_t CONTAINER_BLOCK_HEADER_SIZE = 20;
+static const int64_t CONTAINER_FOOTER_SIZE = 32;
+
+bool huffman_codec::encode_container(std::istream &input, std::ostream &output, int64_t block_size) {
+    if (block_size <= 0 || block_size > MAX_STREAM_BLOCK_SIZE) {
+        return false;
+    }
+    output.write(CONTAINER_MAGIC, 4);
+    write_stream_int(output, CONTAINER_VERSION, 4);
+    write_stream_int(output, (uint64_t) block_size);
+
+    // index entries: raw offset and file offset of every block
+    std::ostringstream index;
+    int64_t raw_offset = 0;
+    int64_t file_offset = CONTAINER_HEADER_SIZE;
+    int64_t block_count = 0;
+    std::string raw(block_size, '\0');
+    while (output) {
+        input.read(&raw[0], block_size);
+        int64_t length = (int64_t) input.gcount();
+        if (length == 0) {
+            break;
+        }
+
+        bit_buffer block;
+        encode_block(raw.data(), length, block);
+        write_stream_int(output, (uint64_t) length);
+        write_stream_int(output, (uint64_t) block.length_bytes());
+        write_stream_int(output, crc32c(raw.data(), (size_t) length), 4);
+        output.write((char const*) block.get_buffer(), block.length_bytes());
+
+        write_stream_int(index, (uint64_t) raw_offset);
+        write_stream_int(index, (uint64_t) file_offset);
+        raw_offset += length;
+        file_offset += CONTAINER_BLOCK_HEADER_SIZE + block.length_bytes();
+        block_count++;
+    }
+
+    std::string index_bytes = index.str();
+    output.write(index_bytes.data(), (std::streamsize) index_bytes.size());
+    write_stream_int(output, (uint64_t) file_offset);
+    write_stream_int(output, (uint64_t) block_count);
+    write_stream_int(output, (uint64_t) raw_offset);
+    write_stream_int(output, crc32c(index_bytes.data(), index_bytes.size()), 4);
+    output.write(CONTAINER_MAGIC, 4);
+    return !input.bad() && (bool) output;
+}
+
+bool huffman_codec::decode_container(std::istream &input, std::ostream &output) {
+    container_reader reader;
+    if (!reader.open(input)) {
+        return false;
+    }
+    std::string block;
+    for (int64_t i = 0; i < reader.block_count(); i++) {
+        if (!reader.read_block(i, block) || !output.write(block.data(), (std::streamsize) block.size())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool huffman_codec::container_reader::open(std::istream &stream) {
+    input = nullptr;
+    raw_offsets.clear();
+    file_offsets.clear();
+
+    char magic[4];
+    uint64_t version, block_size;
+    if (!stream.seekg(0, std::ios::end)) {
+        return false;
+    }
+    int64_t file_size = (int64_t) stream.tellg();
+    if (file_size < CONTAINER_HEADER_SIZE + CONTAINER_FOOTER_SIZE || !stream.seekg(0) ||
+        !stream.read(magic, 4) || memcmp(magic, CONTAINER_MAGIC, 4) != 0 ||
+        !read_stream_int(stream, version, 4) || version != CONTAINER_VERSION ||
+        !read_stream_int(stream, block_size) || block_size == 0) {
+        return false;
+    }
+
+    uint64_t index_offset, count, length, index_crc;
+    if (!stream.seekg(file_size - CONTAINER_FOOTER_SIZE) ||
+        !read_stream_int(stream, index_offset) || !read_stream_int(stream, count) ||
+        !read_stream_int(stream, length) || !read_stream_int(stream, index_crc, 4) ||
+        !stream.read(magic, 4) || memcmp(magic, CONTAINER_MAGIC, 4) != 0 ||
+        index_offset < (uint64_t) CONTAINER_HEADER_SIZE ||
+        count > (uint64_t) (file_size - CONTAINER_FOOTER_SIZE) / 16 ||
+        index_offset + count * 16 != (uint64_t) (file_size - CONTAINER_FOOTER_SIZE)) {
+        return false;
+    }
+
+    std::string index(count * 16, '\0');
+    if (!stream.seekg((std::streamoff) index_offset) || !stream.read(&index[0], (std::streamsize) index.size()) ||
+        crc32c(index.data(), index.size()) != (uint32_t) index_crc) {
+        return false;
+    }
+    std::istringstream entries(index);
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t raw_offset, file_offset;
+        read_stream_int(entries, raw_offset);
+        read_stream_int(entries, file_offset);
+        raw_offsets.add((int64_t) raw_offset);
+        file_offsets.add((int64_t) file_offset);
+    }
+    raw_offsets.add((int64_t) length);
+    file_offsets.add((int64_t) index_offset);
+    input = &stream;
+    return true;
+}
+
+int64_t huffman_codec::container_reader::length() const {
+    return raw_offsets.length() > 0 ? raw_offsets[raw_offsets.length() - 1] : 0;
+}
+
+int64_t huffman_codec::container_reader::block_count() const {
+    return raw_offsets.length() > 0 ? raw_offsets.length() - 1 : 0;
+}
+
+int64_t huffman_codec::container_reader::block_start(int64_t block) const {
+    return raw_offsets[block];
+}
+
+int64_t huffman_codec::container_reader::find_block(int64_t offset) const {
+    if (offset < 0 || offset >= length()) {
+        return -1;
+    }
+    // last block starting at or before offset
+    int64_t low = 0, high = block_count() - 1;
+    while (low < high) {
+        int64_t middle = (low + high + 1) / 2;
+        if (raw_offsets[middle] <= offset) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+bool huffman_codec::container_reader::read_block(int64_t block, std::string &out) {
+    if (input == nullptr || block < 0 || block >= block_count()) {
+        return false;
+    }
+    uint64_t length, size, crc;
+    int64_t expected_length = raw_offsets[block + 1] - raw_offsets[block];
+    int64_t max_size = file_offsets[block + 1] - file_offsets[block] - CONTAINER_BLOCK_HEADER_SIZE;
+    if (!input->seekg((std::streamoff) file_offsets[block]) ||
+        !read_stream_int(*input, length) || !read_stream_int(*input, size) || !read_stream_int(*input, crc, 4) ||
+        length != (uint64_t) expected_length || size != (uint64_t) max_size ||
+        length > (uint64_t) MAX_STREAM_BLOCK_SIZE) {
+        return false;
+    }
+    compressed.resize(size);
+    if (!input->read(&compressed[0], (std::streamsize) size)) {
+        return false;
+    }
+    out.resize(length);
+    return decode_block(compressed.data(), (int64_t) size, &out[0], (int64_t) length) &&
+           crc32c(out.data(), out.size()) == (uint32_t) crc;
+}
@@ -1,5 +1,10 @@
+#include <iostream>
+#include <exception>
+
 #include "rb_map.h"
 #include "array.h"
+#include "small_array.h"
+#include "sort.h"
 #include "buffer.h"
 
 #ifndef H_HUFFMAN_H
@@ -8,56 +13,250 @@
 void print_readable_character(char c);
 
 class huffman_tree {
+public:
+    // symbols under a node, collected only for print_tree
+    typedef small_array<char, 8> node_characters;
+
+    /*
+     * canonical code of one symbol, first bit to write is the lowest bit of bits. Lengths are
+     * bounded by fibonacci growth of weights: a code over MAX_CODE_LENGTH bits would need input
+     * of more than 1.7e13 bytes
+     */
+    struct code_entry {
+        uint64_t bits = 0;
+        int length = 0;
+    };
+
+    static const int MAX_CODE_LENGTH = 63;
+
+private:
     struct tree_node {
-        array<char> characters;
-        char character = 0;
-        int weight = 0;
+        bool leaf = false;
+        char character = 0; // leaves only, any byte value
+        int64_t weight = 0;
 
         tree_node* left = nullptr;
         tree_node* right = nullptr;
 
-        void build_codes(rb_map<char, bit_buffer>& code_map, array<bit>& code);
+        void build_lengths(code_entry* codes, int depth);
+        void collect_characters(node_characters& chars);
         void print_tree(int depth = 0);
         ~tree_node();
     };
 
-    tree_node* build_tree_from_nodes(list<tree_node*>& nodes);
+    tree_node* build_tree_from_nodes(array<tree_node*>& leaves);
+
+    /*
+     * entry for every DECODE_TABLE_BITS-bit prefix of input (first bit is the lowest): codes not
+     * longer than the prefix resolve to symbol and length at once, length 0 marks prefixes of
+     * longer codes, they are decoded bit by bit from canonical code ranges
+     */
+    struct decode_entry {
+        unsigned char symbol = 0;
+        unsigned char length = 0;
+    };
+
+    void read_lengths(bit_buffer::reader& input);
+    void limit_code_lengths(int max_length);
+    void build_canonical_codes();
+    char decode_long_code(bit_buffer::reader& input);
+    char decode_symbol(bit_buffer::reader& input);
 
 public:
     class char_weights {
     public:
-        int weights[256] = {0};
+        int64_t weights[256] = {0};
 
         char_weights();
         char_weights(char_weights const& other);
         char_weights(std::string const& string);
-        char_weights(bit_buffer& buffer);
-        void read(bit_buffer& buffer);
-        void write(bit_buffer& buffer);
+        char_weights(char const* data, int64_t length);
     };
 
 private:
     tree_node* root = nullptr;
     char_weights weights;
-    rb_map<char, bit_buffer> char_codes;
+    code_entry char_codes[256];
+    array<decode_entry> decode_table;
+
+    // canonical code ranges: codes of length l are first_code[l] .. first_code[l] + length_count[l] - 1,
+    // their symbols follow from length_offset[l] in sorted_symbols (sorted by length, then symbol)
+    uint64_t first_code[MAX_CODE_LENGTH + 1] = {0};
+    int length_count[MAX_CODE_LENGTH + 1] = {0};
+    int length_offset[MAX_CODE_LENGTH + 1] = {0};
+    unsigned char sorted_symbols[256] = {0};
 
 public:
-    huffman_tree(char_weights const& weights);
+    static const int DECODE_TABLE_BITS = 11;
+
+    // codes are limited to max_code_length bits (package-merge), tree from print_tree stays unlimited.
+    // Limit below ceil(log2(symbol count)) can't be met and is raised to it, see get_max_code_length()
+    huffman_tree(char_weights const& weights, int max_code_length = MAX_CODE_LENGTH);
+    // read code lengths written by write()
+    huffman_tree(bit_buffer& buffer);
+    huffman_tree(bit_buffer::reader& input);
     ~huffman_tree();
+    // big-endian int64 length followed by codes, data may hold any bytes including NUL
     void encode_string(std::string const &str, bit_buffer &buff);
     std::string decode_string(bit_buffer &buff);
+    void encode_bytes(uint8_t const* data, size_t length, bit_buffer& buff);
+    // returns coded length, output is decoded only if it fits into capacity
+    size_t decode_bytes(bit_buffer& buff, uint8_t* out, size_t capacity);
     void write(bit_buffer& buffer);
 
+    // codes only, no length prefix
+    void encode_symbols(char const* data, int64_t length, bit_buffer& buff);
+    void decode_symbols(bit_buffer::reader& input, char* out, int64_t length);
+    // decodes up to length symbols, but none starting after end_position, returns their count
+    int64_t decode_symbols_before(bit_buffer::reader& input, int64_t end_position, char* out, int64_t length);
+
+    /*
+     * symbol i goes to sub-stream i % INTERLEAVED_STREAMS, so decoder keeps independent readers
+     * and decodes one symbol from each per step. Format (starts on byte boundary): big-endian
+     * int64 byte sizes of all sub-streams but the last, then sub-streams padded to whole bytes
+     */
+    static const int INTERLEAVED_STREAMS = 4;
+
+    void encode_interleaved(char const* data, int64_t length, bit_buffer& buff);
+    void decode_interleaved(bit_buffer const& buff, int64_t position, char* out, int64_t length);
+
 
-    int calculate_size();
+    int get_code_length(char c) const;
+    // longest code in use, the effective length limit
+    int get_max_code_length() const;
+    int64_t calculate_size();
     void print_codes();
     void print_tree();
 };
 
 
 namespace huffman_codec {
-    bit_buffer encode(std::string const& str, bool print_stats = false);
+    bit_buffer encode(std::string const& str, bool print_stats = false, int max_code_length = huffman_tree::MAX_CODE_LENGTH);
     std::string decode(bit_buffer& buffer);
+    // same format over byte spans, decode returns decoded length and writes nothing if it exceeds capacity
+    bit_buffer encode(uint8_t const* data, size_t length, bool print_stats = false, int max_code_length = huffman_tree::MAX_CODE_LENGTH);
+    size_t decode(bit_buffer& buffer, uint8_t* out, size_t capacity);
+
+    /*
+     * block mode: input is split into blocks of block_size bytes coded independently, each with
+     * its own code lengths, so blocks are encoded and decoded in parallel (threads <= 0 means
+     * one per hardware thread). Format, all integers are big-endian int64:
+     *   total length, block size, interleaved flag, block count, end offset (bytes) of every block, blocks
+     * every block is its code lengths header followed by codes, padded to a whole byte; interleaved
+     * blocks keep codes in huffman_tree::INTERLEAVED_STREAMS sub-streams for faster decoding
+     */
+    const int64_t DEFAULT_BLOCK_SIZE = 256 << 10;
+
+    class format_exception : public std::exception {
+    public:
+        const char* what() const noexcept override {
+            return "huffman_codec: malformed block index";
+        }
+    };
+
+    // block_size must be in (0, MAX_STREAM_BLOCK_SIZE], decode_blocks throws format_exception on malformed input
+    bit_buffer encode_blocks(std::string const& str, int64_t block_size = DEFAULT_BLOCK_SIZE, int threads = 0, bool interleaved = false);
+    std::string decode_blocks(bit_buffer& buffer, int threads = 0);
+
+    /*
+     * streaming mode reads input by blocks and writes every block as soon as it is coded, so
+     * memory stays within a few block sizes for any input. Stream is the encoder's block size
+     * followed by a sequence of
+     *   raw length, compressed size (bytes), block (code lengths header and codes)
+     * with big-endian int64 sizes, ended by raw length 0. Both return false on stream errors,
+     * decode_stream also on malformed input. Decoder memory is bounded by max_block_size:
+     * streams with larger blocks and blocks longer than the stream's block size are rejected.
+     */
+    const int64_t MAX_STREAM_BLOCK_SIZE = 1 << 30;
+
+    bool encode_stream(std::istream& input, std::ostream& output, int64_t block_size = DEFAULT_BLOCK_SIZE);
+    bool decode_stream(std::istream& input, std::ostream& output, int64_t max_block_size = MAX_STREAM_BLOCK_SIZE);
+
+    /*
+     * seekable container, big-endian integers:
+     *   header  "HUFC", uint32 version, int64 block size
+     *   blocks  int64 raw size, int64 compressed size, uint32 CRC32C of raw bytes, block
+     *   index   int64 raw offset and int64 file offset of every block
+     *   footer  int64 index offset, int64 block count, int64 total length, uint32 CRC32C of index, "HUFC"
+     * blocks are coded like in streaming mode. Writing needs no seeking, reading seeks to the
+     * footer and index, so a single block can be decoded without touching the others.
+     */
+    const uint32_t CONTAINER_VERSION = 1;
+
+    bool encode_container(std::istream& input, std::ostream& output, int64_t block_size = DEFAULT_BLOCK_SIZE);
+    // input must be seekable, false on stream errors, malformed container or checksum mismatch
+    bool decode_container(std::istream& input, std::ostream& output);
+
+    class container_reader {
+        std::istream* input = nullptr;
+        // one extra entry each: total length and index offset
+        array<int64_t> raw_offsets;
+        array<int64_t> file_offsets;
+        std::string compressed;
+
+    public:
+        // reads header and index, stream must stay alive while reader is used
+        bool open(std::istream& stream);
+
+        int64_t length() const;
+        int64_t block_count() const;
+        int64_t block_start(int64_t block) const;
+        // block holding byte at offset, -1 if offset is out of range
+        int64_t find_block(int64_t offset) const;
+        // decodes one block and verifies its checksum
+        bool read_block(int64_t block, std::string& out);
+    };
+
+    /*
+     * incremental decoder of the streaming format for input arriving in arbitrary fragments.
+     * push() takes bytes of the current block only, so at most one compressed block is buffered:
+     * when it returns less than given, pull() decoded data and push the rest again. Symbols are
+     * decoded once all bits of their code have arrived, a partial code waits for the next push.
+     * Streams with blocks larger than max_block_size fail, so buffered block stays bounded.
+     */
+    class stream_decoder {
+        enum decoder_state {
+            READ_BLOCK_SIZE,
+            READ_LENGTH,
+            READ_SIZE,
+            READ_HEADER,
+            DECODE,
+            FINISHED,
+            FAILED
+        };
+
+        decoder_state state = READ_BLOCK_SIZE;
+        int64_t max_block_size = MAX_STREAM_BLOCK_SIZE;
+        unsigned char field[8];
+        int field_bytes = 0;
+        uint64_t stream_block_size = 0; // longest raw block, from stream header
+        uint64_t block_length = 0; // raw bytes
+        uint64_t block_size = 0; // compressed bytes
+        int64_t decoded = 0;
+        int64_t position = 0; // bits of block consumed
+        bit_buffer block;
+        huffman_tree* tree = nullptr;
+
+        void start_block();
+        void finish_block();
+
+    public:
+        stream_decoder() = default;
+        stream_decoder(int64_t max_block_size);
+        stream_decoder(stream_decoder const&) = delete;
+        stream_decoder& operator= (stream_decoder const&) = delete;
+
+        // returns number of bytes taken, stops at the end of buffered block or the stream
+        int64_t push(char const* data, int64_t size);
+        // returns number of decoded bytes written to out, 0 if more input is needed
+        int64_t pull(char* out, int64_t capacity);
+
+        bool finished() const;
+        bool failed() const;
+        void reset();
+
+        ~stream_decoder();
+    };
 };
 
 #endif
@@ -10,14 +10,34 @@ int main() {
     std::cout << "input string or filename to encode: ";
     std::getline(std::cin, input);
 
-    std::ifstream file;
-    file.open(input);
+    // files are coded block by block, so they never have to fit in memory
+    std::ifstream file(input, std::ios::binary);
     if (file) {
-        input = std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::string encoded_name = input + ".huf";
+        std::string decoded_name = input + ".decoded";
+        std::ofstream encoded(encoded_name, std::ios::binary);
+        if (!huffman_codec::encode_stream(file, encoded)) {
+            std::cout << "failed to encode " << input << "\n";
+            return 1;
+        }
+        encoded.close();
+
+        std::ifstream encoded_input(encoded_name, std::ios::binary);
+        std::ofstream decoded(decoded_name, std::ios::binary);
+        if (!huffman_codec::decode_stream(encoded_input, decoded)) {
+            std::cout << "failed to decode " << encoded_name << "\n";
+            return 1;
+        }
+        file.clear();
+        file.seekg(0, std::ios::end);
+        std::cout << "input size: " << file.tellg() << "\n";
+        std::cout << "encoded to " << encoded_name << ", size: " << encoded_input.tellg() << "\n";
+        std::cout << "decoded to " << decoded_name << "\n";
+        return 0;
     }
 
     bit_buffer buff = huffman_codec::encode(input, true);
     std::cout << "\n\ndecoder output: " << huffman_codec::decode(buff);
 
     return 0;
-}
\ No newline at end of file
+}
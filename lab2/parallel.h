@@ -0,0 +1,31 @@
+#include <thread>
+
+#include "array.h"
+
+
+#ifndef M_PARALLEL_H
+#define M_PARALLEL_H
+
+// threads <= 0 means one per hardware thread
+inline int resolve_thread_count(int threads) {
+    if (threads <= 0) {
+        threads = (int) std::thread::hardware_concurrency();
+    }
+    return threads > 0 ? threads : 1;
+}
+
+// runs task(i) for i in [0, count) on separate threads, task(0) on calling thread
+template <typename F>
+void run_parallel(int count, F const& task) {
+    array<std::thread> workers;
+    workers.reserve(count);
+    for (int i = 1; i < count; i++) {
+        workers.add(std::thread(task, i));
+    }
+    task(0);
+    for (int64_t i = 0; i < workers.length(); i++) {
+        workers[i].join();
+    }
+}
+
+#endif
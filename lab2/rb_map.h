@@ -1,5 +1,7 @@
 #include <iostream>
+#include <functional>
 #include "list.h"
+#include "unrolled_list.h"
 
 
 #ifndef M_MAP_H
@@ -18,8 +20,8 @@ public:
         // red-black tree node
         class rb_node {
         public:
-            typedef typename list<K>::iterator key_iter;
-            typedef typename list<V>::iterator value_iter;
+            typedef typename unrolled_list<K>::iterator key_iter;
+            typedef typename unrolled_list<V>::iterator value_iter;
 
             K key;
             key_iter key_iterator;
@@ -71,6 +73,16 @@ public:
                     right->print();
                 }
             }
+
+            void for_each(std::function<void(K const&, V&)>& func) {
+                if (left != nullptr) {
+                    left->for_each(func);
+                }
+                func(key, *value_iterator);
+                if (right != nullptr) {
+                    right->for_each(func);
+                }
+            }
         };
 
         rb_node* root = nullptr;
@@ -286,6 +298,7 @@ public:
 
         rb_node* tree_successor(rb_node* node) {
             if (node->right != nullptr) {
+                node = node->right;
                 while (node->left != nullptr) {
                     node = node->left;
                 }
@@ -330,14 +343,36 @@ public:
                 }
             }
             if (y != node) {
+                // node takes over the entry of y, so y leaves with the entry being removed
                 node->key = y->key;
-                *node->value_iterator = *y->value_iterator;
+                std::swap(node->key_iterator, y->key_iterator);
+                std::swap(node->value_iterator, y->value_iterator);
             }
             if (y->color == BLACK && x != nullptr) {
                 remove_fixup(x);
             }
             return y;
         }
+
+        // builds balanced subtree from count sorted entries, nodes on the last incomplete level are red
+        rb_node* build_sorted(typename unrolled_list<K>::iterator& key_it, typename unrolled_list<V>::iterator& value_it, int count, int depth, int red_depth) {
+            if (count == 0) {
+                return nullptr;
+            }
+            int left_count = (count - 1) / 2;
+            rb_node* left_node = build_sorted(key_it, value_it, left_count, depth + 1, red_depth);
+            rb_node* node = new rb_node(key_it++, value_it++);
+            node->color = depth == red_depth ? RED : BLACK;
+            node->left = left_node;
+            node->right = build_sorted(key_it, value_it, count - 1 - left_count, depth + 1, red_depth);
+            if (node->left != nullptr) {
+                node->left->parent = node;
+            }
+            if (node->right != nullptr) {
+                node->right->parent = node;
+            }
+            return node;
+        }
     };
 
 public:
@@ -347,8 +382,9 @@ public:
 
 private:
     rb_tree tree;
-    list<K> key_list;
-    list<V> value_list;
+    // entries are kept in chunked lists, nodes refer to them by stable iterators
+    unrolled_list<K> key_list;
+    unrolled_list<V> value_list;
 
 public:
     typedef typename rb_map<K, V>::rb_tree::rb_node node_t;
@@ -393,6 +429,34 @@ public:
         return find(key) != nullptr;
     }
 
+    // replaces content with entries, keys must be unique and sorted in ascending order, O(n)
+    void load_sorted(unrolled_list<K> const& keys, unrolled_list<V> const& values) {
+        clear();
+        auto value_it = values.begin();
+        for (auto key_it = keys.begin(); key_it != keys.end(); key_it++, value_it++) {
+            key_list.add(*key_it);
+            value_list.add(*value_it);
+        }
+
+        int count = key_list.get_length();
+        int full_depth = 0;
+        while ((2 << full_depth) - 1 <= count) {
+            full_depth++;
+        }
+        int red_depth = (1 << full_depth) - 1 == count ? -1 : full_depth;
+
+        auto key_it = key_list.begin();
+        auto list_value_it = value_list.begin();
+        tree.root = tree.build_sorted(key_it, list_value_it, count, 0, red_depth);
+    }
+
+    // visits all entries in ascending key order
+    void for_each(std::function<void(K const&, V&)> func) {
+        if (tree.root != nullptr) {
+            tree.root->for_each(func);
+        }
+    }
+
     void print() {
         std::cout << "{";
         if (tree.root != nullptr) {
@@ -407,11 +471,11 @@ public:
         std::cout << "\n";
     }
 
-    list<K>& keys() {
+    unrolled_list<K>& keys() {
         return key_list;
     }
 
-    list<V>& values() {
+    unrolled_list<V>& values() {
         return value_list;
     }
 
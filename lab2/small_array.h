@@ -0,0 +1,211 @@
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+
+#include "allocator.h"
+
+
+#ifndef M_SMALL_ARRAY_H
+#define M_SMALL_ARRAY_H
+
+/*
+ * array with inline storage for N elements, the heap (Allocator) is used only after it grows
+ * past N, shrink_to_fit() returns to inline storage. Same interface as array<T>.
+ */
+template <typename T, int64_t N, typename Allocator = heap_allocator>
+class small_array : private Allocator {
+    static_assert(N > 0, "small_array needs inline capacity");
+
+    T* allocated_memory = inline_memory();
+    int64_t allocated_memory_size = N;
+
+    int64_t size = 0;
+
+    alignas(T) unsigned char inline_storage[N * sizeof(T)];
+
+    T* inline_memory() {
+        return reinterpret_cast<T*>(inline_storage);
+    }
+
+    bool is_inline() const {
+        return allocated_memory == reinterpret_cast<T const*>(inline_storage);
+    }
+
+    static void destroy(T* from, T* to) {
+        if (!std::is_trivially_destructible<T>::value) {
+            for (; from != to; from++) {
+                from->~T();
+            }
+        }
+    }
+
+    static void relocate(T* destination, T* source, int64_t count) {
+        if (std::is_trivially_copyable<T>::value) {
+            if (count > 0) {
+                memcpy((void*) destination, (void const*) source, sizeof(T) * (size_t) count);
+            }
+        } else {
+            for (int64_t i = 0; i < count; i++) {
+                new (destination + i) T(std::move_if_noexcept(source[i]));
+            }
+            destroy(source, source + count);
+        }
+    }
+
+    void free_heap_memory() {
+        if (!is_inline()) {
+            Allocator::deallocate(allocated_memory, sizeof(T) * (size_t) allocated_memory_size, alignof(T));
+        }
+        allocated_memory = inline_memory();
+        allocated_memory_size = N;
+    }
+
+    void reallocate(int64_t new_capacity) {
+        T* new_memory = new_capacity <= N ? inline_memory() :
+                static_cast<T*>(Allocator::allocate(sizeof(T) * (size_t) new_capacity, alignof(T)));
+        if (new_memory == allocated_memory) {
+            return;
+        }
+        relocate(new_memory, allocated_memory, size);
+        free_heap_memory();
+        allocated_memory = new_memory;
+        allocated_memory_size = new_capacity <= N ? N : new_capacity;
+    }
+
+    void ensure_size(int64_t size) {
+        if (allocated_memory_size < size) {
+            int64_t new_size = allocated_memory_size * 2;
+            while (new_size < size) {
+                new_size *= 2;
+            }
+            reallocate(new_size);
+        }
+    }
+
+public:
+    small_array() = default;
+
+    small_array(int64_t size) {
+        resize(size);
+    }
+
+    small_array(Allocator const& allocator) : Allocator(allocator) {}
+
+    small_array(small_array const& other) : Allocator(other) {
+        add_all(other);
+    }
+
+    small_array(small_array&& other) noexcept : Allocator(other) {
+        *this = std::move(other);
+    }
+
+    small_array& operator= (small_array const& other) {
+        if (this != &other) {
+            resize(0);
+            add_all(other);
+        }
+        return *this;
+    }
+
+    small_array& operator= (small_array&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        clear();
+        Allocator::operator=(other);
+        if (other.is_inline()) {
+            relocate(allocated_memory, other.allocated_memory, other.size);
+        } else {
+            allocated_memory = other.allocated_memory;
+            allocated_memory_size = other.allocated_memory_size;
+            other.allocated_memory = other.inline_memory();
+            other.allocated_memory_size = N;
+        }
+        size = other.size;
+        other.size = 0;
+        return *this;
+    }
+
+    int64_t length() const {
+        return size;
+    }
+
+    int64_t capacity() const {
+        return allocated_memory_size;
+    }
+
+    T& operator[] (int64_t index) {
+        return allocated_memory[index];
+    }
+
+    T const& operator[] (int64_t index) const {
+        return allocated_memory[index];
+    }
+
+    void resize(int64_t new_size) {
+        if (new_size < size) {
+            destroy(allocated_memory + new_size, allocated_memory + size);
+        } else {
+            ensure_size(new_size);
+            for (int64_t i = size; i < new_size; i++) {
+                new (allocated_memory + i) T();
+            }
+        }
+        size = new_size;
+    }
+
+    void reserve(int64_t capacity) {
+        if (capacity > allocated_memory_size) {
+            reallocate(capacity);
+        }
+    }
+
+    void shrink_to_fit() {
+        if (allocated_memory_size > size && !is_inline()) {
+            reallocate(size);
+        }
+    }
+
+    T& add(T const& elem) {
+        if (size == allocated_memory_size) {
+            T copy(elem); // elem may live in memory that is about to be reallocated
+            ensure_size(size + 1);
+            return *new (allocated_memory + size++) T(std::move(copy));
+        }
+        return *new (allocated_memory + size++) T(elem);
+    }
+
+    T& add(T&& elem) {
+        if (size == allocated_memory_size) {
+            T moved(std::move(elem));
+            ensure_size(size + 1);
+            return *new (allocated_memory + size++) T(std::move(moved));
+        }
+        return *new (allocated_memory + size++) T(std::move(elem));
+    }
+
+    // appends elements of any array-like container (array, small_array)
+    template <typename C>
+    void add_all(C const& arr) {
+        int64_t count = arr.length();
+        ensure_size(size + count);
+        for (int64_t i = 0; i < count; i++) {
+            new (allocated_memory + size + i) T(arr[i]);
+        }
+        size += count;
+    }
+
+    void clear() {
+        destroy(allocated_memory, allocated_memory + size);
+        free_heap_memory();
+        size = 0;
+    }
+
+    ~small_array() {
+        clear();
+    }
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+
+#include "array.h"
+#include "parallel.h"
+
+
+#ifndef M_SORT_H
+#define M_SORT_H
+
+/*
+ * in-place sorts over array<T>:
+ *   radix_sort     - LSD radix by bytes for integer and floating point keys, stable, O(n) extra memory
+ *   parallel_sort  - chunks are sorted by std::sort on separate threads and merged pairwise in parallel
+ *   stable_sort    - same as parallel_sort, but chunks are sorted by std::stable_sort, so order of
+ *                    equal elements is kept (merge takes from the left run first)
+ */
+
+namespace sort_detail {
+    // maps key to unsigned integer with the same order
+    template <typename T, bool FLOAT = std::is_floating_point<T>::value>
+    struct radix_key;
+
+    template <typename T>
+    struct radix_key<T, false> {
+        static_assert(std::is_integral<T>::value, "radix_sort needs integer or floating point keys");
+        typedef typename std::make_unsigned<T>::type type;
+
+        static type get(T value) {
+            type key = (type) value;
+            if (std::is_signed<T>::value) {
+                key ^= type(1) << (sizeof(T) * 8 - 1);
+            }
+            return key;
+        }
+    };
+
+    template <typename T>
+    struct radix_key<T, true> {
+        typedef typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type type;
+        static_assert(sizeof(T) == sizeof(type), "unsupported floating point size");
+
+        // negative numbers are inverted entirely, positive ones get sign bit set
+        static type get(T value) {
+            type key;
+            memcpy(&key, &value, sizeof(T));
+            type sign = type(1) << (sizeof(T) * 8 - 1);
+            return (key & sign) ? ~key : key | sign;
+        }
+    };
+
+    const int64_t MIN_PARALLEL_CHUNK = 1 << 14;
+
+    inline int thread_count(int threads, int64_t size) {
+        threads = resolve_thread_count(threads);
+        int64_t max_threads = size / MIN_PARALLEL_CHUNK;
+        if (threads > max_threads) {
+            threads = (int) max_threads;
+        }
+        return threads > 0 ? threads : 1;
+    }
+
+    template <typename T, typename A, typename Compare>
+    void merge_sort(array<T, A>& arr, Compare compare, int threads, bool stable) {
+        int64_t size = arr.length();
+        threads = thread_count(threads, size);
+        if (threads == 1) {
+            if (stable) {
+                std::stable_sort(&arr[0], &arr[0] + size, compare);
+            } else {
+                std::sort(&arr[0], &arr[0] + size, compare);
+            }
+            return;
+        }
+
+        // run i is [bounds[i], bounds[i + 1])
+        array<int64_t> bounds;
+        for (int i = 0; i <= threads; i++) {
+            bounds.add(size * i / threads);
+        }
+        T* data = &arr[0];
+        run_parallel(threads, [&] (int i) -> void {
+            if (stable) {
+                std::stable_sort(data + bounds[i], data + bounds[i + 1], compare);
+            } else {
+                std::sort(data + bounds[i], data + bounds[i + 1], compare);
+            }
+        });
+
+        array<T> buffer(size);
+        T* source = data;
+        T* target = &buffer[0];
+        while (bounds.length() > 2) {
+            int64_t runs = bounds.length() - 1;
+            run_parallel((int) ((runs + 1) / 2), [&] (int pair) -> void {
+                int64_t begin = bounds[pair * 2];
+                int64_t middle = bounds[pair * 2 + 1];
+                int64_t end = pair * 2 + 2 < bounds.length() ? bounds[pair * 2 + 2] : middle;
+                std::merge(std::make_move_iterator(source + begin), std::make_move_iterator(source + middle),
+                           std::make_move_iterator(source + middle), std::make_move_iterator(source + end),
+                           target + begin, compare);
+            });
+            array<int64_t> merged_bounds;
+            for (int64_t i = 0; i < bounds.length(); i += 2) {
+                merged_bounds.add(bounds[i]);
+            }
+            if (merged_bounds[merged_bounds.length() - 1] != size) {
+                merged_bounds.add(size);
+            }
+            bounds = std::move(merged_bounds);
+            std::swap(source, target);
+        }
+        if (source != data) {
+            std::move(source, source + size, data);
+        }
+    }
+}
+
+template <typename T, typename A>
+void radix_sort(array<T, A>& arr) {
+    typedef sort_detail::radix_key<T> key;
+    int64_t size = arr.length();
+    if (size < 2) {
+        return;
+    }
+
+    // histograms of all digits are counted in one pass
+    const int DIGITS = sizeof(T);
+    array<int64_t> counts(DIGITS * 256);
+    for (int64_t i = 0; i < size; i++) {
+        typename key::type k = key::get(arr[i]);
+        for (int d = 0; d < DIGITS; d++) {
+            counts[d * 256 + ((k >> (d * 8)) & 255)]++;
+        }
+    }
+
+    array<T> buffer(size);
+    T* source = &arr[0];
+    T* target = &buffer[0];
+    for (int d = 0; d < DIGITS; d++) {
+        int64_t* digit_counts = &counts[d * 256];
+        // all keys share this digit, pass would not move anything
+        if (digit_counts[(key::get(source[0]) >> (d * 8)) & 255] == size) {
+            continue;
+        }
+        int64_t offset = 0;
+        for (int b = 0; b < 256; b++) {
+            int64_t count = digit_counts[b];
+            digit_counts[b] = offset;
+            offset += count;
+        }
+        for (int64_t i = 0; i < size; i++) {
+            target[digit_counts[(key::get(source[i]) >> (d * 8)) & 255]++] = source[i];
+        }
+        std::swap(source, target);
+    }
+    if (source != &arr[0]) {
+        memcpy((void*) &arr[0], (void const*) source, sizeof(T) * (size_t) size);
+    }
+}
+
+// threads <= 0 means one per hardware thread
+template <typename T, typename A, typename Compare = std::less<T>>
+void parallel_sort(array<T, A>& arr, Compare compare = Compare(), int threads = 0) {
+    if (arr.length() > 1) {
+        sort_detail::merge_sort(arr, compare, threads, false);
+    }
+}
+
+template <typename T, typename A, typename Compare = std::less<T>>
+void stable_sort(array<T, A>& arr, Compare compare = Compare(), int threads = 0) {
+    if (arr.length() > 1) {
+        sort_detail::merge_sort(arr, compare, threads, true);
+    }
+}
+
+#endif
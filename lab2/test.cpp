@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <random>
+#include <sstream>
 #include "gtest/gtest.h"
 #include "rb_map.h"
 #include "array.h"
+#include "sort.h"
 #include "huffman.h"
+#include "crc32c.h"
 
 
 // encoder test
@@ -15,6 +20,400 @@ TEST (codec, encode_and_decode) {
     }
 }
 
+// fibonacci weights give codes longer than decode table prefix
+TEST (codec, long_codes) {
+    std::string encode_string;
+    int64_t a = 1, b = 1;
+    for (int i = 0; i < 20; i++) {
+        encode_string += std::string(a, char('a' + i));
+        int64_t next = a + b;
+        a = b;
+        b = next;
+    }
+    std::shuffle(encode_string.begin(), encode_string.end(), std::mt19937(5));
+    bit_buffer buff = huffman_codec::encode(encode_string);
+    ASSERT_EQ(huffman_codec::decode(buff), encode_string);
+
+    // single symbol still gets a 1-bit code, so codes stay canonical
+    ASSERT_EQ(huffman_tree(std::string("zzzz")).get_code_length('z'), 1);
+    buff = huffman_codec::encode("zzzz");
+    ASSERT_EQ(huffman_codec::decode(buff), "zzzz");
+}
+
+TEST (codec, length_limited_codes) {
+    std::string encode_string;
+    int64_t a = 1, b = 1;
+    for (int i = 0; i < 30; i++) {
+        encode_string += std::string(a, char('A' + i));
+        int64_t next = a + b;
+        a = b;
+        b = next;
+    }
+    std::shuffle(encode_string.begin(), encode_string.end(), std::mt19937(6));
+
+    huffman_tree unlimited(encode_string);
+    ASSERT_GT(unlimited.get_code_length('A'), 11);
+    // 30 symbols need at least 5 bits
+    ASSERT_EQ(huffman_tree(encode_string, 3).get_max_code_length(), 5);
+    int64_t last_size = 0;
+    for (int limit = 5; limit <= 12; limit++) {
+        huffman_tree limited(encode_string, limit);
+        double kraft = 0;
+        for (int i = 0; i < 30; i++) {
+            int length = limited.get_code_length(char('A' + i));
+            ASSERT_LE(length, limit);
+            ASSERT_GT(length, 0);
+            kraft += 1.0 / (int64_t(1) << length);
+        }
+        ASSERT_DOUBLE_EQ(kraft, 1.0);
+        // looser limit never costs more, and limited codes never beat unlimited ones
+        ASSERT_GE(limited.calculate_size(), unlimited.calculate_size());
+        if (last_size > 0) {
+            ASSERT_LE(limited.calculate_size(), last_size);
+        }
+        last_size = limited.calculate_size();
+
+        bit_buffer buff = huffman_codec::encode(encode_string, false, limit);
+        ASSERT_EQ(huffman_codec::decode(buff), encode_string);
+    }
+}
+
+TEST (codec, char_weights) {
+    srand(4);
+    std::string input;
+    for (int i = 0; i < (5 << 20) + 13; i++) {
+        input += i % 7 == 0 ? char(rand() % 256) : 'q';
+    }
+    int64_t expected[256] = {0};
+    for (char c : input) {
+        expected[(unsigned char) c]++;
+    }
+    huffman_tree::char_weights weights(input);
+    huffman_tree::char_weights tail(input.data() + 3, 29);
+    for (int c = 0; c < 256; c++) {
+        ASSERT_EQ(weights.weights[c], expected[c]);
+        expected[c] = 0;
+    }
+    for (int i = 3; i < 32; i++) {
+        expected[(unsigned char) input[i]]++;
+    }
+    for (int c = 0; c < 256; c++) {
+        ASSERT_EQ(tail.weights[c], expected[c]);
+    }
+}
+
+// only code lengths are stored, so short messages stay small
+TEST (codec, compact_header) {
+    std::string message = "short message, canonical codes";
+    bit_buffer buff = huffman_codec::encode(message);
+    ASSERT_LT(buff.length_bytes(), 64);
+    ASSERT_EQ(huffman_codec::decode(buff), message);
+
+    std::string all_symbols;
+    for (int i = 1; i < 256; i++) {
+        all_symbols += std::string(i, char(i));
+    }
+    buff = huffman_codec::encode(all_symbols);
+    ASSERT_EQ(huffman_codec::decode(buff), all_symbols);
+}
+
+// every byte value including NUL, with explicit lengths
+TEST (codec, binary_data) {
+    std::string zeros(1000, '\0');
+    bit_buffer buff = huffman_codec::encode(zeros);
+    ASSERT_EQ(huffman_codec::decode(buff), zeros);
+
+    srand(12);
+    array<uint8_t> data;
+    for (int i = 0; i < 50000; i++) {
+        data.add(i % 4 == 0 ? (uint8_t) (rand() % 256) : (uint8_t) (rand() % 3));
+    }
+    buff = huffman_codec::encode(&data[0], (size_t) data.length());
+    ASSERT_EQ(huffman_codec::decode(buff, nullptr, 0), (size_t) data.length());
+    array<uint8_t> decoded(data.length());
+    ASSERT_EQ(huffman_codec::decode(buff, &decoded[0], (size_t) decoded.length()), (size_t) data.length());
+    for (int64_t i = 0; i < data.length(); i++) {
+        ASSERT_EQ(decoded[i], data[i]);
+    }
+
+    std::string with_nul("a\0b\0\0c", 6);
+    buff = huffman_codec::encode(with_nul);
+    ASSERT_EQ(huffman_codec::decode(buff), with_nul);
+}
+
+TEST (codec, blocks) {
+    srand(9);
+    std::string encode_string;
+    for (int i = 0; i < 100000; i++) {
+        encode_string += i % 3 == 0 ? char(rand() % 256) : char('a' + rand() % 6);
+    }
+    for (int64_t block_size : {1000, 4096, 1 << 20}) {
+        for (int threads : {1, 3}) {
+            bit_buffer buff = huffman_codec::encode_blocks(encode_string, block_size, threads);
+            ASSERT_EQ(huffman_codec::decode_blocks(buff, 4), encode_string);
+            // odd sizes leave sub-streams of different lengths
+            bit_buffer interleaved = huffman_codec::encode_blocks(encode_string.substr(0, 99999), block_size, threads, true);
+            ASSERT_EQ(huffman_codec::decode_blocks(interleaved, threads), encode_string.substr(0, 99999));
+        }
+    }
+    bit_buffer empty = huffman_codec::encode_blocks("");
+    ASSERT_EQ(huffman_codec::decode_blocks(empty), "");
+
+    // malformed index is rejected before anything is allocated by it
+    ASSERT_THROW(huffman_codec::encode_blocks(encode_string, 0), std::invalid_argument);
+    bit_buffer valid = huffman_codec::encode_blocks(encode_string, 4096, 1, true);
+    // length, block size, block count, first block end
+    for (int field : {0, 1, 3, 4}) {
+        bit_buffer corrupt(valid);
+        corrupt.get_buffer()[field * 8] ^= 0x40;
+        ASSERT_THROW(huffman_codec::decode_blocks(corrupt), huffman_codec::format_exception);
+    }
+    bit_buffer truncated;
+    truncated.write_bytes(valid.get_buffer(), 20);
+    ASSERT_THROW(huffman_codec::decode_blocks(truncated), huffman_codec::format_exception);
+
+    // corrupt interleaved sub-stream sizes only garble that block's output
+    bit_buffer corrupt(valid);
+    int64_t first_block = 32 + 8 * ((int64_t) encode_string.size() + 4095) / 4096;
+    for (int64_t i = first_block; i < first_block + 300; i++) {
+        corrupt.get_buffer()[i] = 0xFF;
+    }
+    std::string decoded = huffman_codec::decode_blocks(corrupt);
+    ASSERT_EQ(decoded.size(), encode_string.size());
+    ASSERT_EQ(decoded.substr(4096), encode_string.substr(4096));
+}
+
+TEST (codec, streams) {
+    srand(10);
+    std::string input;
+    for (int i = 0; i < 300000; i++) {
+        input += i % 5 == 0 ? char(rand() % 256) : char('0' + rand() % 10);
+    }
+    for (int64_t block_size : {1, 777, 65536, 1 << 20}) {
+        std::istringstream raw(input.substr(0, block_size * 3 + 5 < 300000 ? block_size * 3 + 5 : 300000));
+        std::stringstream encoded;
+        std::ostringstream decoded;
+        ASSERT_TRUE(huffman_codec::encode_stream(raw, encoded, block_size));
+        ASSERT_TRUE(huffman_codec::decode_stream(encoded, decoded));
+        ASSERT_EQ(decoded.str(), raw.str());
+    }
+
+    std::istringstream empty("");
+    std::stringstream encoded;
+    std::ostringstream decoded;
+    ASSERT_TRUE(huffman_codec::encode_stream(empty, encoded));
+    ASSERT_TRUE(huffman_codec::decode_stream(encoded, decoded));
+    ASSERT_EQ(decoded.str(), "");
+
+    // stream cut in the middle of a block
+    std::istringstream raw(input);
+    std::stringstream full;
+    huffman_codec::encode_stream(raw, full, 4096);
+    std::stringstream truncated(full.str().substr(0, 10000));
+    ASSERT_FALSE(huffman_codec::decode_stream(truncated, decoded));
+
+    // blocks above decoder limit or above stream's own block size are refused before allocation
+    std::stringstream limited(full.str());
+    ASSERT_FALSE(huffman_codec::decode_stream(limited, decoded, 1024));
+    std::string oversized = full.str();
+    oversized[8 + 4] = 1; // first block length becomes 2^24 + 4096
+    std::stringstream oversized_stream(oversized);
+    ASSERT_FALSE(huffman_codec::decode_stream(oversized_stream, decoded));
+
+    // raw length above what the block's codes hold must not decode padding as symbols
+    std::istringstream short_input("abc");
+    std::stringstream short_encoded;
+    huffman_codec::encode_stream(short_input, short_encoded, 4096);
+    std::string inflated = short_encoded.str();
+    inflated[8 + 7] = 100;
+    std::stringstream inflated_stream(inflated);
+    ASSERT_FALSE(huffman_codec::decode_stream(inflated_stream, decoded));
+}
+
+TEST (codec, stream_decoder) {
+    srand(11);
+    std::string input;
+    for (int i = 0; i < 200000; i++) {
+        input += i % 7 == 0 ? char(rand() % 256) : char('a' + rand() % (1 + i % 26));
+    }
+    std::istringstream raw(input);
+    std::stringstream encoded_stream;
+    ASSERT_TRUE(huffman_codec::encode_stream(raw, encoded_stream, 30000));
+    std::string encoded = encoded_stream.str();
+
+    // fragments and output spans of varying sizes, including single bytes
+    for (int fragment : {1, 3, 1000, 1 << 20}) {
+        huffman_codec::stream_decoder decoder;
+        std::string output;
+        char out[777];
+        int64_t offset = 0;
+        int step = 0;
+        while (!decoder.finished()) {
+            ASSERT_FALSE(decoder.failed());
+            int64_t size = std::min((int64_t) fragment + step % 5, (int64_t) encoded.size() - offset);
+            int64_t taken = decoder.push(encoded.data() + offset, size);
+            offset += taken;
+            int64_t pulled;
+            do {
+                pulled = decoder.pull(out, 1 + step++ % 777);
+                output.append(out, pulled);
+            } while (pulled > 0);
+            ASSERT_TRUE(taken > 0 || decoder.finished() || size == 0);
+        }
+        ASSERT_EQ(offset, (int64_t) encoded.size());
+        ASSERT_EQ(output, input);
+    }
+
+    huffman_codec::stream_decoder decoder;
+    std::string corrupt(16, '\xff');
+    decoder.push(corrupt.data(), (int64_t) corrupt.size());
+    ASSERT_TRUE(decoder.failed());
+
+    // stream written with 30000-byte blocks
+    huffman_codec::stream_decoder limited(20000);
+    limited.push(encoded.data(), 8);
+    ASSERT_TRUE(limited.failed());
+    huffman_codec::stream_decoder enough(30000);
+    enough.push(encoded.data(), 16);
+    ASSERT_FALSE(enough.failed());
+
+    // raw length larger than the codes can satisfy fails instead of waiting for input forever
+    std::istringstream short_input("abc");
+    std::stringstream short_encoded;
+    huffman_codec::encode_stream(short_input, short_encoded, 4096);
+    std::string inflated = short_encoded.str();
+    inflated[8 + 7] = 100;
+    huffman_codec::stream_decoder inflated_decoder;
+    char out[256];
+    int64_t offset = 0;
+    for (int step = 0; step < 10 && !inflated_decoder.failed(); step++) {
+        offset += inflated_decoder.push(inflated.data() + offset, (int64_t) inflated.size() - offset);
+        while (inflated_decoder.pull(out, sizeof(out)) > 0) {}
+    }
+    ASSERT_TRUE(inflated_decoder.failed());
+}
+
+TEST (codec, container) {
+    srand(13);
+    std::string input;
+    for (int i = 0; i < 100000; i++) {
+        input += i % 3 == 0 ? char(rand() % 256) : char('a' + (i / 1000) % 26);
+    }
+    std::istringstream raw(input);
+    std::stringstream encoded;
+    ASSERT_TRUE(huffman_codec::encode_container(raw, encoded, 7000));
+
+    std::ostringstream decoded;
+    ASSERT_TRUE(huffman_codec::decode_container(encoded, decoded));
+    ASSERT_EQ(decoded.str(), input);
+
+    // any byte is found through the index, only its block is decoded
+    huffman_codec::container_reader reader;
+    ASSERT_TRUE(reader.open(encoded));
+    ASSERT_EQ(reader.length(), (int64_t) input.size());
+    ASSERT_EQ(reader.block_count(), 15);
+    ASSERT_EQ(reader.find_block(-1), -1);
+    ASSERT_EQ(reader.find_block((int64_t) input.size()), -1);
+    std::string block;
+    for (int64_t offset : {0, 6999, 7000, 50000, 99999}) {
+        int64_t index = reader.find_block(offset);
+        ASSERT_EQ(index, offset / 7000);
+        ASSERT_TRUE(reader.read_block(index, block));
+        ASSERT_EQ(block[offset - reader.block_start(index)], input[offset]);
+    }
+
+    // flipped bit in block data fails checksum, other blocks still decode
+    std::string bytes = encoded.str();
+    bytes[16 + 20 + 100] ^= 4;
+    std::stringstream corrupted(bytes);
+    ASSERT_TRUE(reader.open(corrupted));
+    ASSERT_FALSE(reader.read_block(0, block));
+    ASSERT_TRUE(reader.read_block(1, block));
+    ASSERT_EQ(block, input.substr(7000, 7000));
+
+    std::stringstream truncated(bytes.substr(0, bytes.size() - 1));
+    ASSERT_FALSE(reader.open(truncated));
+
+    std::istringstream empty("");
+    std::stringstream empty_encoded;
+    ASSERT_TRUE(huffman_codec::encode_container(empty, empty_encoded));
+    ASSERT_TRUE(reader.open(empty_encoded));
+    ASSERT_EQ(reader.block_count(), 0);
+}
+
+TEST (crc32c, known_values) {
+    ASSERT_EQ(crc32c("123456789", 9), 0xE3069283u);
+    ASSERT_EQ(crc32c("", 0), 0u);
+
+    std::string data;
+    for (int i = 0; i < 1000; i++) {
+        data += char(i * 7);
+    }
+    uint32_t whole = crc32c(data.data(), data.size());
+    ASSERT_EQ(crc32c(data.data() + 333, data.size() - 333, crc32c(data.data(), 333)), whole);
+    ASSERT_EQ(~crc32c_detail::software(~0u, (unsigned char const*) data.data(), data.size()), whole);
+}
+
+// bit buffer tests
+TEST (bit_buffer, more_than_2_31_bits) {
+    const int64_t chunk = 1 << 20;
+    const int64_t chunks = 257;
+    array<byte> data(chunk);
+    for (int64_t i = 0; i < chunk; i++) {
+        data[i] = byte(i * 7);
+    }
+
+    bit_buffer buffer;
+    for (int64_t i = 0; i < chunks; i++) {
+        buffer.write_bytes(&data[0], chunk);
+    }
+    buffer.write_bit(1);
+    ASSERT_EQ(buffer.length_bits(), chunks * chunk * 8 + 1);
+    ASSERT_GT(buffer.length_bits(), (int64_t) INT32_MAX);
+    ASSERT_EQ(buffer.length_bytes(), chunks * chunk + 1);
+    ASSERT_EQ(buffer.get_buffer()[(chunks - 1) * chunk + 12345], data[12345]);
+    ASSERT_EQ(buffer.get_buffer()[chunks * chunk] & 1, 1);
+}
+
+TEST (bit_buffer, bulk_bits) {
+    srand(5);
+    array<uint64_t> values;
+    array<int> widths;
+    bit_buffer buff;
+    for (int i = 0; i < 10000; i++) {
+        int width = rand() % 65;
+        uint64_t value = ((uint64_t) rand() << 40 ^ (uint64_t) rand() << 20 ^ (uint64_t) rand());
+        value &= width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+        if (width == 1 && i % 2 == 0) {
+            buff.write_bit((bit) value);
+        } else {
+            buff.write_bits(value, width);
+        }
+        values.add(value);
+        widths.add(width);
+    }
+
+    bit_buffer::reader reader(buff);
+    for (int i = 0; i < values.length(); i++) {
+        if (widths[i] == 0) {
+            continue;
+        }
+        ASSERT_EQ(buff.peek_bits(widths[i]), values[i]);
+        if (i % 3 == 0) {
+            buff.skip_bits(widths[i]);
+        } else {
+            ASSERT_EQ(buff.read_bits(widths[i]), values[i]);
+        }
+        int low = widths[i] > 32 ? 32 : widths[i];
+        ASSERT_EQ(reader.read(low), values[i] & ((uint64_t(1) << low) - 1));
+        if (widths[i] > 32) {
+            ASSERT_EQ(reader.read(widths[i] - 32), values[i] >> 32);
+        }
+    }
+    ASSERT_EQ(reader.position(), buff.length_bits());
+    ASSERT_EQ(buff.read_bits(10), 0);
+}
+
 // array tests
 TEST (array, massive_add_and_check) {
     array<std::string> arr;
@@ -29,6 +428,156 @@ TEST (array, massive_add_and_check) {
     ASSERT_EQ(arr.length(), 0);
 }
 
+TEST (array, growth_and_capacity) {
+    array<array<std::string>> rows;
+    for (int i = 0; i < 100; i++) {
+        array<std::string>& row = rows.add(array<std::string>());
+        for (int j = 0; j <= i; j++) {
+            row.add(std::to_string(j));
+        }
+    }
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(rows[i].length(), i + 1);
+        ASSERT_EQ(rows[i][i], std::to_string(i));
+    }
+
+    array<int> arr;
+    arr.reserve(100);
+    ASSERT_EQ(arr.capacity(), 100);
+    for (int i = 0; i < 10; i++) {
+        arr.add(i);
+    }
+    arr.add_all(arr);
+    ASSERT_EQ(arr.length(), 20);
+    ASSERT_EQ(arr[15], 5);
+    arr.shrink_to_fit();
+    ASSERT_EQ(arr.capacity(), 20);
+    arr.resize(5);
+    arr.resize(8);
+    ASSERT_EQ(arr[4], 4);
+    ASSERT_EQ(arr[7], 0);
+    arr.add(arr[0]);
+    ASSERT_EQ(arr[8], 0);
+}
+
+// allocator policies
+TEST (array, allocator_policies) {
+    array<double, aligned_allocator<64>> aligned;
+    for (int i = 0; i < 1000; i++) {
+        aligned.add(i);
+        ASSERT_EQ((uintptr_t) &aligned[0] % 64, 0);
+    }
+
+    array<int64_t, huge_page_allocator> huge;
+    huge.resize(1 << 20);
+    huge[(1 << 20) - 1] = 7;
+    huge.add(8);
+    ASSERT_EQ(huge[(1 << 20) - 1], 7);
+    ASSERT_EQ(huge[1 << 20], 8);
+    huge.clear();
+
+    arena temporaries;
+    for (int round = 0; round < 3; round++) {
+        temporaries.reset();
+        array<std::string, arena_allocator> tokens(temporaries);
+        for (int i = 0; i < 5000; i++) {
+            tokens.add(std::to_string(i));
+        }
+        array<std::string, arena_allocator> copy(tokens);
+        ASSERT_EQ(copy.length(), 5000);
+        ASSERT_EQ(copy[4999], "4999");
+        array<std::string> heap_copy;
+        heap_copy.add_all(copy);
+        ASSERT_EQ(heap_copy[123], "123");
+    }
+}
+
+// small array tests
+TEST (small_array, inline_and_spill) {
+    small_array<std::string, 4> arr;
+    for (int i = 0; i < 4; i++) {
+        arr.add(std::to_string(i));
+    }
+    ASSERT_EQ(arr.capacity(), 4);
+    std::string* inline_data = &arr[0];
+
+    small_array<std::string, 4> moved(std::move(arr));
+    ASSERT_EQ(moved.length(), 4);
+    ASSERT_EQ(arr.length(), 0);
+    ASSERT_NE(&moved[0], inline_data);
+
+    for (int i = 4; i < 100; i++) {
+        moved.add(moved[i - 4]);
+    }
+    ASSERT_GT(moved.capacity(), 4);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(moved[i], std::to_string(i % 4));
+    }
+
+    small_array<std::string, 4> copy(moved);
+    copy.resize(3);
+    copy.shrink_to_fit();
+    ASSERT_EQ(copy.capacity(), 4);
+    ASSERT_EQ(copy[2], "2");
+
+    array<std::string> heap;
+    heap.add("x");
+    copy.add_all(heap);
+    copy.add_all(copy);
+    ASSERT_EQ(copy.length(), 8);
+    ASSERT_EQ(copy[7], "x");
+}
+
+// sort tests
+TEST (sort, radix_sort_keys) {
+    srand(11);
+    array<int> ints;
+    array<double> doubles;
+    array<uint64_t> wide;
+    for (int i = 0; i < 100000; i++) {
+        ints.add(rand() - RAND_MAX / 2);
+        doubles.add((rand() - RAND_MAX / 2) / 1000.0);
+        wide.add((uint64_t) rand() << 33 | (uint64_t) rand());
+    }
+    doubles.add(-0.0);
+    doubles.add(0.0);
+    radix_sort(ints);
+    radix_sort(doubles);
+    radix_sort(wide);
+    for (int i = 1; i < ints.length(); i++) {
+        ASSERT_LE(ints[i - 1], ints[i]);
+        ASSERT_LE(wide[i - 1], wide[i]);
+    }
+    for (int i = 1; i < doubles.length(); i++) {
+        ASSERT_LE(doubles[i - 1], doubles[i]);
+    }
+}
+
+TEST (sort, parallel_and_stable) {
+    srand(12);
+    array<std::string> words;
+    array<std::pair<int, int>> pairs;
+    for (int i = 0; i < 200000; i++) {
+        words.add(std::to_string(rand()));
+        pairs.add(std::make_pair(rand() % 100, i));
+    }
+    parallel_sort(words, std::greater<std::string>(), 4);
+    for (int i = 1; i < words.length(); i++) {
+        ASSERT_GE(words[i - 1], words[i]);
+    }
+
+    // equal keys must keep ascending second values
+    stable_sort(pairs, [] (std::pair<int, int> const& a, std::pair<int, int> const& b) -> bool {
+        return a.first < b.first;
+    }, 3);
+    for (int i = 1; i < pairs.length(); i++) {
+        ASSERT_LE(pairs[i - 1].first, pairs[i].first);
+        if (pairs[i - 1].first == pairs[i].first) {
+            ASSERT_LT(pairs[i - 1].second, pairs[i].second);
+        }
+    }
+}
+
 // keep hardest test for rb_map
 TEST (rb_map, massive_random_load) {
     rb_map<int, int> map;
@@ -0,0 +1,193 @@
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+
+#ifndef M_ALLOCATOR_H
+#define M_ALLOCATOR_H
+
+/*
+ * storage policies for array<T, Allocator>, every policy provides
+ *   void* allocate(size_t bytes, size_t alignment);
+ *   void deallocate(void* memory, size_t bytes, size_t alignment);
+ * deallocate always gets the same byte count and alignment that were allocated
+ */
+
+// global operator new, default policy
+class heap_allocator {
+public:
+    void* allocate(size_t bytes, size_t alignment) {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return ::operator new(bytes, std::align_val_t(alignment));
+        }
+        return ::operator new(bytes);
+    }
+
+    void deallocate(void* memory, size_t /*bytes*/, size_t alignment) {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(memory, std::align_val_t(alignment));
+        } else {
+            ::operator delete(memory);
+        }
+    }
+};
+
+// storage aligned to ALIGNMENT bytes (cache line by default), so SIMD kernels may use aligned loads
+template <size_t ALIGNMENT = 64>
+class aligned_allocator {
+    static_assert((ALIGNMENT & (ALIGNMENT - 1)) == 0, "alignment must be power of two");
+
+public:
+    void* allocate(size_t bytes, size_t alignment) {
+        return ::operator new(bytes, std::align_val_t(alignment > ALIGNMENT ? alignment : ALIGNMENT));
+    }
+
+    void deallocate(void* memory, size_t /*bytes*/, size_t alignment) {
+        ::operator delete(memory, std::align_val_t(alignment > ALIGNMENT ? alignment : ALIGNMENT));
+    }
+};
+
+/*
+ * large blocks are mapped directly and marked for transparent huge pages to cut TLB misses on
+ * multi-GB arrays, blocks under HUGE_PAGE_THRESHOLD (and all blocks outside linux) come from
+ * the heap aligned to cache line
+ */
+class huge_page_allocator {
+public:
+    static const size_t HUGE_PAGE_SIZE = 2 << 20;
+    static const size_t HUGE_PAGE_THRESHOLD = 4 << 20;
+
+    void* allocate(size_t bytes, size_t alignment) {
+#ifdef __linux__
+        if (bytes >= HUGE_PAGE_THRESHOLD && alignment <= HUGE_PAGE_SIZE) {
+            void* memory = mmap(nullptr, round_up(bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+#ifdef MADV_HUGEPAGE
+            madvise(memory, round_up(bytes), MADV_HUGEPAGE);
+#endif
+            return memory;
+        }
+#endif
+        return aligned_allocator<64>().allocate(bytes, alignment);
+    }
+
+    void deallocate(void* memory, size_t bytes, size_t alignment) {
+#ifdef __linux__
+        if (bytes >= HUGE_PAGE_THRESHOLD && alignment <= HUGE_PAGE_SIZE) {
+            munmap(memory, round_up(bytes));
+            return;
+        }
+#endif
+        aligned_allocator<64>().deallocate(memory, bytes, alignment);
+    }
+
+    static size_t round_up(size_t bytes) {
+        return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+};
+
+/*
+ * bump allocator for short-lived temporaries: memory is taken from blocks sequentially and
+ * released all at once by reset(), which keeps the first block for reuse. Only freeing the
+ * latest allocation gives memory back (the top is rolled back).
+ */
+class arena {
+    struct block {
+        block* next;
+        size_t size;
+    };
+
+    static const size_t BLOCK_SIZE = 16 << 10;
+
+    block* blocks = nullptr;
+    char* top = nullptr;
+    char* limit = nullptr;
+    char* last_allocation = nullptr;
+
+    void add_block(size_t min_size) {
+        size_t size = min_size + sizeof(block) > BLOCK_SIZE ? min_size + sizeof(block) : BLOCK_SIZE;
+        block* new_block = static_cast<block*>(::operator new(size));
+        new_block->next = blocks;
+        new_block->size = size;
+        blocks = new_block;
+        top = reinterpret_cast<char*>(new_block + 1);
+        limit = reinterpret_cast<char*>(new_block) + size;
+    }
+
+public:
+    arena() = default;
+    arena(arena const&) = delete;
+    arena& operator= (arena const&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment) {
+        char* aligned = top != nullptr ? (char*) (((uintptr_t) top + alignment - 1) & ~(uintptr_t) (alignment - 1)) : nullptr;
+        if (aligned == nullptr || aligned + bytes > limit) {
+            add_block(bytes + alignment);
+            aligned = (char*) (((uintptr_t) top + alignment - 1) & ~(uintptr_t) (alignment - 1));
+        }
+        top = aligned + bytes;
+        last_allocation = aligned;
+        return aligned;
+    }
+
+    void deallocate(void* memory, size_t bytes, size_t /*alignment*/) {
+        if (memory == last_allocation && (char*) memory + bytes == top) {
+            top = last_allocation;
+            last_allocation = nullptr;
+        }
+    }
+
+    // frees everything allocated so far, objects in arena must be destroyed before
+    void reset() {
+        while (blocks != nullptr && blocks->next != nullptr) {
+            block* next = blocks->next;
+            ::operator delete(blocks);
+            blocks = next;
+        }
+        if (blocks != nullptr) {
+            if (blocks->size > BLOCK_SIZE) {
+                ::operator delete(blocks);
+                blocks = nullptr;
+                top = limit = nullptr;
+            } else {
+                top = reinterpret_cast<char*>(blocks + 1);
+                limit = reinterpret_cast<char*>(blocks) + blocks->size;
+            }
+        }
+        last_allocation = nullptr;
+    }
+
+    ~arena() {
+        reset();
+        ::operator delete(blocks);
+    }
+};
+
+// array policy taking memory from arena, default constructed one uses the heap
+class arena_allocator {
+    arena* source = nullptr;
+
+public:
+    arena_allocator() = default;
+    arena_allocator(arena& source) : source(&source) {}
+
+    void* allocate(size_t bytes, size_t alignment) {
+        return source != nullptr ? source->allocate(bytes, alignment) : heap_allocator().allocate(bytes, alignment);
+    }
+
+    void deallocate(void* memory, size_t bytes, size_t alignment) {
+        if (source != nullptr) {
+            source->deallocate(memory, bytes, alignment);
+        } else {
+            heap_allocator().deallocate(memory, bytes, alignment);
+        }
+    }
+};
+
+#endif
@@ -35,7 +35,7 @@ Graph::Vertex *Graph::get_vertex(int index) {
 Graph::Vertex *Graph::get_vertex(std::string const &name) {
     auto found = vertex_map.find(name);
     if (found != nullptr) {
-        return **found;
+        return &vertices[**found];
     }
     return nullptr;
 }
@@ -47,14 +47,8 @@ Graph::Vertex &Graph::get_or_make_vertex(std::string const &name) {
     }
     Vertex vertex(name, vertices.length());
     vertices.add(vertex);
-    vertex_map[name] = &(vertices[vertex.index]);
-    weights.add(array<double>());
-    for (int i = 0; i < weights.length(); i++) {
-        array<double>& row = weights[i];
-        while (row.length() < weights.length()) {
-            row.add(INF);
-        }
-    }
+    vertex_map[name] = vertex.index;
+    weights.resize(vertices.length(), vertices.length(), INF);
     return vertices[vertex.index];
 }
 
@@ -74,8 +68,10 @@ bool Graph::read(std::string filename) {
         clear();
 
         std::string line;
+        arena token_arena; // tokens of one line live until the next line is read
         while (std::getline(stream, line)) {
-            array<std::string> tokens;
+            token_arena.reset();
+            array<std::string, arena_allocator> tokens(token_arena);
 
             char* token = strtok(line.data(), ";");
             while (token != nullptr) {
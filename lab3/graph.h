@@ -2,6 +2,7 @@
 #include <string.h>
 
 #include "array.h"
+#include "matrix.h"
 #include "rb_map.h"
 
 
@@ -23,8 +24,8 @@ public:
 
 private:
     array<Vertex> vertices;
-    rb_map<std::string, Vertex*> vertex_map; // map for faster access
-    array<array<double>> weights;
+    rb_map<std::string, int> vertex_map; // map for faster access, stores indices as vertices may be reallocated
+    matrix<double> weights;
 
 public:
     void connect(int index1, int index2, double weight);
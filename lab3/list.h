@@ -88,12 +88,12 @@ public:
         return *this;
     }
 
-    iterator begin() {
+    iterator begin() const {
         return first != nullptr ? iterator(first) : end();
     }
 
-    iterator end() {
-        return iterator(&list_end);
+    iterator end() const {
+        return iterator((list_node*) &list_end);
     }
 
     iterator add(T const& value) {
@@ -146,7 +146,7 @@ public:
         length = 0;
     }
 
-    int get_length() {
+    int get_length() const {
         return length;
     }
 
@@ -0,0 +1,258 @@
+#include <string>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+#ifndef M_MAPPED_ARRAY_H
+#define M_MAPPED_ARRAY_H
+
+/*
+ * array<T> kept in a memory-mapped file, so data larger than RAM is paged in by the kernel and
+ * a saved array reopens without reading it. File is a 64-byte header (magic, element size,
+ * length) followed by elements; the header lives in the mapping too, so length is persisted
+ * by every modification. Capacity doubles by ftruncate and remap, pointers and references to
+ * elements are invalidated by growth like in array<T>. Only trivially copyable T are allowed.
+ */
+template <typename T>
+class mapped_array {
+    static_assert(std::is_trivially_copyable<T>::value, "mapped_array stores raw bytes of elements");
+    static_assert(alignof(T) <= 64, "elements are aligned to header size");
+
+public:
+    enum access_mode {
+        READ_ONLY,
+        READ_WRITE
+    };
+
+    enum access_advice {
+        ADVICE_NORMAL,
+        ADVICE_SEQUENTIAL,
+        ADVICE_RANDOM,
+        ADVICE_WILLNEED
+    };
+
+    class io_exception : public std::exception {
+    public:
+        const char* what() const noexcept override {
+            return "mapped_array: failed to grow or sync mapped file";
+        }
+    };
+
+private:
+    static const uint64_t MAGIC = 0x3130595252414d4dull; // "MMARRY01" little-endian
+
+    struct file_header {
+        uint64_t magic;
+        uint64_t element_size;
+        int64_t length;
+        char padding[40];
+    };
+
+    static_assert(sizeof(file_header) == 64, "header must keep elements aligned");
+
+    int fd = -1;
+    bool writable = false;
+    char* mapping = nullptr;
+    int64_t mapping_size = 0; // bytes
+    int64_t capacity_elements = 0;
+    access_advice advice = ADVICE_NORMAL; // reapplied to every new mapping
+
+    void apply_advice() {
+        int flags[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED};
+        madvise(mapping, (size_t) mapping_size, flags[advice]);
+    }
+
+    file_header* header() const {
+        return reinterpret_cast<file_header*>(mapping);
+    }
+
+    T* elements() const {
+        return reinterpret_cast<T*>(mapping + sizeof(file_header));
+    }
+
+    bool map(int64_t bytes) {
+        void* memory = mmap(nullptr, (size_t) bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        mapping = static_cast<char*>(memory);
+        mapping_size = bytes;
+        capacity_elements = (bytes - (int64_t) sizeof(file_header)) / (int64_t) sizeof(T);
+        if (advice != ADVICE_NORMAL) {
+            apply_advice();
+        }
+        return true;
+    }
+
+    void unmap() {
+        if (mapping != nullptr) {
+            munmap(mapping, (size_t) mapping_size);
+            mapping = nullptr;
+            mapping_size = 0;
+            capacity_elements = 0;
+        }
+    }
+
+    // file is extended before remapping, so pages past its end are never touched
+    void grow_file(int64_t capacity) {
+        int64_t bytes = (int64_t) sizeof(file_header) + capacity * (int64_t) sizeof(T);
+        unmap();
+        if (ftruncate(fd, (off_t) bytes) != 0 || !map(bytes)) {
+            throw io_exception();
+        }
+    }
+
+    void ensure_size(int64_t size) {
+        if (capacity_elements < size) {
+            int64_t new_capacity = capacity_elements > 0 ? capacity_elements : 4;
+            while (new_capacity < size) {
+                new_capacity *= 2;
+            }
+            grow_file(new_capacity);
+        }
+    }
+
+public:
+    mapped_array() = default;
+    mapped_array(mapped_array const&) = delete;
+    mapped_array& operator= (mapped_array const&) = delete;
+
+    // maps array stored at path, READ_WRITE creates an empty one if file does not exist,
+    // returns false if file can't be opened or is not a mapped_array of T
+    bool open(std::string const& path, access_mode mode = READ_WRITE) {
+        close();
+        writable = mode == READ_WRITE;
+        fd = ::open(path.data(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat info;
+        bool success = fstat(fd, &info) == 0;
+        if (success && info.st_size == 0 && writable) {
+            file_header empty = {};
+            empty.magic = MAGIC;
+            empty.element_size = sizeof(T);
+            success = pwrite(fd, &empty, sizeof(empty), 0) == (ssize_t) sizeof(empty) && fstat(fd, &info) == 0;
+        }
+        success = success && info.st_size >= (off_t) sizeof(file_header) && map((int64_t) info.st_size);
+        if (success) {
+            file_header* h = header();
+            success = h->magic == MAGIC && h->element_size == sizeof(T) &&
+                      h->length >= 0 && h->length <= capacity_elements;
+        }
+        if (!success) {
+            close();
+        }
+        return success;
+    }
+
+    bool is_open() const {
+        return mapping != nullptr;
+    }
+
+    // writes dirty pages to disk
+    void flush() {
+        if (mapping != nullptr && writable && msync(mapping, (size_t) mapping_size, MS_SYNC) != 0) {
+            throw io_exception();
+        }
+    }
+
+    void close() {
+        unmap();
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    // tells kernel how elements will be accessed, hints are best effort and survive growth
+    void advise(access_advice advice) {
+        this->advice = advice;
+        if (mapping != nullptr) {
+            apply_advice();
+        }
+    }
+
+    int64_t length() const {
+        return mapping != nullptr ? header()->length : 0;
+    }
+
+    int64_t capacity() const {
+        return capacity_elements;
+    }
+
+    T& operator[] (int64_t index) {
+        return elements()[index];
+    }
+
+    T const& operator[] (int64_t index) const {
+        return elements()[index];
+    }
+
+    // following methods need READ_WRITE mode
+
+    void reserve(int64_t capacity) {
+        if (capacity > capacity_elements) {
+            grow_file(capacity);
+        }
+    }
+
+    // new elements are value-initialized
+    void resize(int64_t new_size) {
+        int64_t size = length();
+        ensure_size(new_size);
+        for (int64_t i = size; i < new_size; i++) {
+            new (elements() + i) T();
+        }
+        header()->length = new_size;
+    }
+
+    T& add(T const& elem) {
+        int64_t size = length();
+        if (size == capacity_elements) {
+            T copy(elem); // elem may live in mapping that is about to be moved
+            ensure_size(size + 1);
+            elements()[size] = copy;
+        } else {
+            elements()[size] = elem;
+        }
+        header()->length = size + 1;
+        return elements()[size];
+    }
+
+    // values must not point into this array
+    void add_all(T const* values, int64_t count) {
+        int64_t size = length();
+        ensure_size(size + count);
+        memcpy((void*) (elements() + size), (void const*) values, sizeof(T) * (size_t) count);
+        header()->length = size + count;
+    }
+
+    // drops elements, file keeps its capacity
+    void clear() {
+        if (mapping != nullptr) {
+            header()->length = 0;
+        }
+    }
+
+    // truncates file to current length
+    void shrink_to_fit() {
+        if (capacity_elements > length()) {
+            grow_file(length());
+        }
+    }
+
+    ~mapped_array() {
+        close();
+    }
+};
+
+#endif
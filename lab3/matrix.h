@@ -0,0 +1,260 @@
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+
+#include "allocator.h"
+
+
+#ifndef M_MATRIX_H
+#define M_MATRIX_H
+
+/*
+ * dense 2D array in one row-major allocation. Rows start on cache line boundaries (stride is
+ * padded), and capacity grows geometrically in both dimensions, so adding a row and a column
+ * at a time is amortized O(rows + columns) per step instead of reallocating every row.
+ */
+template <typename T, typename Allocator = aligned_allocator<64>>
+class matrix : private Allocator {
+public:
+    static const int64_t CACHE_LINE = 64;
+
+    template <typename E>
+    class row_view_t {
+        E* data;
+        int64_t size;
+
+    public:
+        row_view_t(E* data, int64_t size) : data(data), size(size) {}
+
+        E& operator[] (int64_t column) const {
+            return data[column];
+        }
+
+        int64_t length() const {
+            return size;
+        }
+
+        E* begin() const {
+            return data;
+        }
+
+        E* end() const {
+            return data + size;
+        }
+    };
+
+    template <typename E>
+    class column_view_t {
+        E* data;
+        int64_t stride;
+        int64_t size;
+
+    public:
+        column_view_t(E* data, int64_t stride, int64_t size) : data(data), stride(stride), size(size) {}
+
+        E& operator[] (int64_t row) const {
+            return data[row * stride];
+        }
+
+        int64_t length() const {
+            return size;
+        }
+    };
+
+    typedef row_view_t<T> row_view;
+    typedef row_view_t<T const> const_row_view;
+    typedef column_view_t<T> column_view;
+    typedef column_view_t<T const> const_column_view;
+
+private:
+    T* memory = nullptr;
+    int64_t rows = 0;
+    int64_t columns = 0;
+    int64_t row_capacity = 0;
+    int64_t stride = 0; // column capacity, padded to whole cache lines
+
+    static int64_t pad_stride(int64_t columns) {
+        int64_t line_elements = sizeof(T) < CACHE_LINE && CACHE_LINE % sizeof(T) == 0 ? CACHE_LINE / sizeof(T) : 1;
+        return (columns + line_elements - 1) / line_elements * line_elements;
+    }
+
+    static size_t alignment() {
+        return alignof(T) > CACHE_LINE ? alignof(T) : CACHE_LINE;
+    }
+
+    static void destroy(T* from, T* to) {
+        if (!std::is_trivially_destructible<T>::value) {
+            for (; from != to; from++) {
+                from->~T();
+            }
+        }
+    }
+
+    void free_memory() {
+        if (memory != nullptr) {
+            for (int64_t i = 0; i < rows; i++) {
+                destroy(memory + i * stride, memory + i * stride + columns);
+            }
+            Allocator::deallocate(memory, sizeof(T) * (size_t) (row_capacity * stride), alignment());
+            memory = nullptr;
+        }
+    }
+
+    void reallocate(int64_t new_row_capacity, int64_t new_stride) {
+        T* new_memory = static_cast<T*>(Allocator::allocate(sizeof(T) * (size_t) (new_row_capacity * new_stride), alignment()));
+        for (int64_t i = 0; i < rows; i++) {
+            T* source = memory + i * stride;
+            T* destination = new_memory + i * new_stride;
+            if (std::is_trivially_copyable<T>::value) {
+                memcpy((void*) destination, (void const*) source, sizeof(T) * (size_t) columns);
+            } else {
+                for (int64_t j = 0; j < columns; j++) {
+                    new (destination + j) T(std::move_if_noexcept(source[j]));
+                }
+            }
+        }
+        free_memory(); // only destroys moved-from cells, trivial ones need no destruction
+        memory = new_memory;
+        row_capacity = new_row_capacity;
+        stride = new_stride;
+    }
+
+public:
+    matrix() = default;
+
+    matrix(int64_t rows, int64_t columns, T const& fill = T()) {
+        resize(rows, columns, fill);
+    }
+
+    matrix(matrix const& other) : Allocator(other) {
+        *this = other;
+    }
+
+    matrix(matrix&& other) noexcept : Allocator(other) {
+        *this = std::move(other);
+    }
+
+    matrix& operator= (matrix const& other) {
+        if (this != &other) {
+            clear();
+            if (other.rows > 0 && other.columns > 0) {
+                reallocate(other.rows, pad_stride(other.columns));
+                for (int64_t i = 0; i < other.rows; i++) {
+                    for (int64_t j = 0; j < other.columns; j++) {
+                        new (memory + i * stride + j) T(other.memory[i * other.stride + j]);
+                    }
+                }
+            }
+            rows = other.rows;
+            columns = other.columns;
+        }
+        return *this;
+    }
+
+    matrix& operator= (matrix&& other) noexcept {
+        if (this != &other) {
+            clear();
+            Allocator::operator=(other);
+            std::swap(memory, other.memory);
+            std::swap(rows, other.rows);
+            std::swap(columns, other.columns);
+            std::swap(row_capacity, other.row_capacity);
+            std::swap(stride, other.stride);
+        }
+        return *this;
+    }
+
+    int64_t row_count() const {
+        return rows;
+    }
+
+    int64_t column_count() const {
+        return columns;
+    }
+
+    // distance in elements between starts of neighbouring rows
+    int64_t row_stride() const {
+        return stride;
+    }
+
+    T& operator() (int64_t row, int64_t column) {
+        return memory[row * stride + column];
+    }
+
+    T const& operator() (int64_t row, int64_t column) const {
+        return memory[row * stride + column];
+    }
+
+    row_view operator[] (int64_t row) {
+        return row_view(memory + row * stride, columns);
+    }
+
+    const_row_view operator[] (int64_t row) const {
+        return const_row_view(memory + row * stride, columns);
+    }
+
+    row_view get_row(int64_t row) {
+        return (*this)[row];
+    }
+
+    const_row_view get_row(int64_t row) const {
+        return (*this)[row];
+    }
+
+    column_view get_column(int64_t column) {
+        return column_view(memory + column, stride, rows);
+    }
+
+    const_column_view get_column(int64_t column) const {
+        return const_column_view(memory + column, stride, rows);
+    }
+
+    // new cells are set to fill, cells outside new size are destroyed, capacity is kept
+    void resize(int64_t new_rows, int64_t new_columns, T const& fill = T()) {
+        if (new_rows > row_capacity || new_columns > stride) {
+            int64_t new_row_capacity = row_capacity;
+            if (new_rows > row_capacity) {
+                new_row_capacity = row_capacity * 2 > new_rows ? row_capacity * 2 : new_rows;
+            }
+            int64_t new_stride = stride;
+            if (new_columns > stride) {
+                new_stride = pad_stride(stride * 2 > new_columns ? stride * 2 : new_columns);
+            }
+            reallocate(new_row_capacity, new_stride);
+        }
+
+        int64_t kept_rows = rows < new_rows ? rows : new_rows;
+        for (int64_t i = 0; i < kept_rows; i++) {
+            T* row = memory + i * stride;
+            if (new_columns < columns) {
+                destroy(row + new_columns, row + columns);
+            }
+            for (int64_t j = columns; j < new_columns; j++) {
+                new (row + j) T(fill);
+            }
+        }
+        for (int64_t i = new_rows; i < rows; i++) {
+            destroy(memory + i * stride, memory + i * stride + columns);
+        }
+        for (int64_t i = rows; i < new_rows; i++) {
+            for (int64_t j = 0; j < new_columns; j++) {
+                new (memory + i * stride + j) T(fill);
+            }
+        }
+        rows = new_rows;
+        columns = new_columns;
+    }
+
+    void clear() {
+        free_memory();
+        rows = columns = row_capacity = stride = 0;
+    }
+
+    ~matrix() {
+        clear();
+    }
+};
+
+#endif
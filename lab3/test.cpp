@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "rb_map.h"
 #include "array.h"
+#include "matrix.h"
+#include "mapped_array.h"
 #include "graph.h"
 #include "pathfinding.h"
 
@@ -25,6 +27,105 @@ TEST (graph, fully_connected_pathfinding) {
     }
 }
 
+TEST (graph, read_file) {
+    std::string filename = "unit_test.tmp";
+    {
+        std::ofstream file(filename);
+        file << "A;B;10;N/A\nB;C;20;N/A\nA;C;25;10\n\nbroken line\nC;D;N/A;5\n";
+    }
+    Graph mGraph;
+    ASSERT_TRUE(mGraph.read(filename));
+    ASSERT_EQ(mGraph.size(), 4);
+    Graph::Vertex* a = mGraph.get_vertex("A");
+    Graph::Vertex* c = mGraph.get_vertex("C");
+    Graph::Vertex* d = mGraph.get_vertex("D");
+    ASSERT_NE(d, nullptr);
+    ASSERT_EQ(mGraph.get_weight(*a, *c), 25);
+    ASSERT_EQ(mGraph.get_weight(*c, *a), 10);
+    ASSERT_EQ(mGraph.get_weight(*d, *c), 5);
+    ASSERT_EQ(mGraph.get_weight(*c, *d), Graph::INF);
+
+    auto paths = bellman_floid_algorithm::get_shortest_paths(mGraph, *a);
+    ASSERT_EQ(paths[c->index].weight, 25);
+    remove(filename.data());
+}
+
+// matrix tests
+TEST (matrix, grow_and_views) {
+    matrix<double> weights;
+    for (int n = 1; n <= 100; n++) {
+        weights.resize(n, n, -1);
+        for (int i = 0; i < n; i++) {
+            weights[n - 1][i] = (n - 1) * 1000 + i;
+            weights[i][n - 1] = i * 1000 + n - 1;
+        }
+        ASSERT_EQ((uintptr_t) &weights(n - 1, 0) % matrix<double>::CACHE_LINE, 0);
+    }
+    ASSERT_EQ(weights.row_count(), 100);
+    ASSERT_EQ(weights.column_count(), 100);
+    ASSERT_EQ(weights.row_stride() % 8, 0);
+    for (int i = 0; i < 100; i++) {
+        auto row = weights.get_row(i);
+        auto column = weights.get_column(i);
+        ASSERT_EQ(row.length(), 100);
+        for (int j = 0; j < 100; j++) {
+            ASSERT_EQ(row[j], i * 1000 + j);
+            ASSERT_EQ(column[j], j * 1000 + i);
+        }
+    }
+
+    matrix<std::string> names(2, 3, "x");
+    names[1][2] = "last";
+    names.resize(3, 2, "y");
+    matrix<std::string> copy(names);
+    ASSERT_EQ(copy[1][1], "x");
+    ASSERT_EQ(copy[2][0], "y");
+    names.resize(3, 3, "z");
+    ASSERT_EQ(names[1][2], "z");
+    names.clear();
+    ASSERT_EQ(names.row_count(), 0);
+}
+
+// mapped array tests
+TEST (mapped_array, grow_and_reopen) {
+    std::string path = "mapped_array_test.tmp";
+    remove(path.data());
+    {
+        mapped_array<double> distances;
+        ASSERT_TRUE(distances.open(path));
+        distances.advise(mapped_array<double>::ADVICE_SEQUENTIAL);
+        for (int i = 0; i < 100000; i++) {
+            distances.add(i * 0.5);
+        }
+        double tail[] = {-1, -2, -3};
+        distances.add_all(tail, 3);
+        ASSERT_EQ(distances.length(), 100003);
+        ASSERT_GE(distances.capacity(), 100003);
+        distances.flush();
+    }
+    {
+        mapped_array<double> distances;
+        ASSERT_TRUE(distances.open(path, mapped_array<double>::READ_ONLY));
+        ASSERT_EQ(distances.length(), 100003);
+        for (int i = 0; i < 100000; i++) {
+            ASSERT_EQ(distances[i], i * 0.5);
+        }
+        ASSERT_EQ(distances[100002], -3);
+    }
+    {
+        // wrong element type is rejected
+        mapped_array<int> wrong;
+        ASSERT_FALSE(wrong.open(path));
+        mapped_array<double> distances;
+        ASSERT_TRUE(distances.open(path));
+        distances.resize(10);
+        distances.shrink_to_fit();
+        ASSERT_EQ(distances.capacity(), 10);
+        ASSERT_EQ(distances[9], 4.5);
+    }
+    remove(path.data());
+}
+
 // array tests
 TEST (array, massive_add_and_check) {
     array<std::string> arr;
@@ -0,0 +1,312 @@
+#include <iostream>
+#include <new>
+#include <utility>
+#include <stdint.h>
+
+
+#ifndef M_UNROLLED_LIST_H
+#define M_UNROLLED_LIST_H
+
+/*
+ * list that keeps CHUNK_SIZE elements per node, so add allocates once per chunk and iteration
+ * walks contiguous slots. Elements are appended to the last chunk and never moved, erase only
+ * destroys the element and marks its slot free, so iterators and references stay valid until
+ * their own element is erased. Chunks left without elements go to a free list and are reused.
+ */
+template <typename T, int CHUNK_SIZE = 16>
+class unrolled_list {
+    static_assert(CHUNK_SIZE > 0 && CHUNK_SIZE <= 64, "chunk slots are tracked by 64-bit mask");
+
+public:
+    class list_chunk {
+    public:
+        alignas(T) unsigned char storage[CHUNK_SIZE * sizeof(T)];
+        uint64_t live_mask = 0;
+        int used = 0; // slots handed out, only the last chunk keeps growing
+        int live = 0;
+
+        list_chunk* next = nullptr;
+        list_chunk* prev = nullptr;
+
+        T* slot(int index) {
+            return reinterpret_cast<T*>(storage) + index;
+        }
+
+        bool is_live(int index) const {
+            return (live_mask >> index) & 1;
+        }
+    };
+
+    class iterator {
+    public:
+        list_chunk* chunk = nullptr;
+        int index = 0;
+
+        iterator() {}
+        iterator(list_chunk* chunk, int index) : chunk(chunk), index(index) {}
+
+        // first live slot at or after current position, nullptr chunk means end
+        iterator& skip_forward() {
+            while (chunk != nullptr) {
+                while (index < chunk->used && !chunk->is_live(index)) {
+                    index++;
+                }
+                if (index < chunk->used) {
+                    break;
+                }
+                chunk = chunk->next;
+                index = 0;
+            }
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator last = *this;
+            index++;
+            if (index >= chunk->used || !chunk->is_live(index)) {
+                skip_forward();
+            }
+            return last;
+        }
+
+        // moves to previous element, must not be called on begin() or end()
+        iterator operator--(int) {
+            iterator last = *this;
+            do {
+                if (index == 0) {
+                    chunk = chunk->prev;
+                    index = chunk->used;
+                }
+                index--;
+            } while (!chunk->is_live(index));
+            return last;
+        }
+
+        T& operator*() {
+            return *chunk->slot(index);
+        }
+
+        T* operator->() {
+            return chunk->slot(index);
+        }
+
+        bool operator==(iterator const& it) const {
+            return it.chunk == chunk && it.index == index;
+        }
+
+        bool operator!=(iterator const& it) const {
+            return !(*this == it);
+        }
+    };
+
+private:
+    list_chunk* first = nullptr;
+    list_chunk* last = nullptr;
+    list_chunk* free_chunks = nullptr;
+    int length = 0;
+
+    list_chunk* acquire_chunk() {
+        list_chunk* chunk = free_chunks;
+        if (chunk != nullptr) {
+            free_chunks = chunk->next;
+            chunk->next = nullptr;
+        } else {
+            chunk = new list_chunk();
+        }
+        if (last != nullptr) {
+            last->next = chunk;
+            chunk->prev = last;
+        } else {
+            first = chunk;
+        }
+        last = chunk;
+        return chunk;
+    }
+
+    void release_chunk(list_chunk* chunk) {
+        if (chunk->prev != nullptr) {
+            chunk->prev->next = chunk->next;
+        } else {
+            first = chunk->next;
+        }
+        if (chunk->next != nullptr) {
+            chunk->next->prev = chunk->prev;
+        } else {
+            last = chunk->prev;
+        }
+        chunk->used = chunk->live = 0;
+        chunk->live_mask = 0;
+        chunk->prev = nullptr;
+        chunk->next = free_chunks;
+        free_chunks = chunk;
+    }
+
+    T* next_slot() {
+        list_chunk* chunk = last;
+        if (chunk == nullptr || chunk->used == CHUNK_SIZE) {
+            chunk = acquire_chunk();
+        }
+        int index = chunk->used++;
+        chunk->live_mask |= uint64_t(1) << index;
+        chunk->live++;
+        length++;
+        return chunk->slot(index);
+    }
+
+public:
+    unrolled_list() = default;
+
+    unrolled_list(unrolled_list const& other) {
+        add_all(other);
+    }
+
+    unrolled_list(unrolled_list&& other) noexcept {
+        splice(other);
+    }
+
+    unrolled_list& operator= (unrolled_list const& other) {
+        if (this != &other) {
+            clear();
+            add_all(other);
+        }
+        return *this;
+    }
+
+    unrolled_list& operator= (unrolled_list&& other) noexcept {
+        if (this != &other) {
+            clear();
+            splice(other);
+        }
+        return *this;
+    }
+
+    iterator begin() const {
+        return iterator(first, 0).skip_forward();
+    }
+
+    iterator end() const {
+        return iterator();
+    }
+
+    iterator add(T const& value) {
+        T* slot = next_slot();
+        new (slot) T(value);
+        return iterator(last, last->used - 1);
+    }
+
+    iterator add(T&& value) {
+        T* slot = next_slot();
+        new (slot) T(std::move(value));
+        return iterator(last, last->used - 1);
+    }
+
+    // bulk append, fills whole chunks at once
+    void add_all(T const* values, int count) {
+        while (count > 0) {
+            list_chunk* chunk = last;
+            if (chunk == nullptr || chunk->used == CHUNK_SIZE) {
+                chunk = acquire_chunk();
+            }
+            int batch = CHUNK_SIZE - chunk->used < count ? CHUNK_SIZE - chunk->used : count;
+            for (int i = 0; i < batch; i++) {
+                new (chunk->slot(chunk->used + i)) T(values[i]);
+            }
+            uint64_t batch_mask = batch == 64 ? ~uint64_t(0) : (uint64_t(1) << batch) - 1;
+            chunk->live_mask |= batch_mask << chunk->used;
+            chunk->used += batch;
+            chunk->live += batch;
+            length += batch;
+            values += batch;
+            count -= batch;
+        }
+    }
+
+    void add_all(unrolled_list const& other) {
+        if (&other == this) {
+            unrolled_list copy(other);
+            splice(copy);
+            return;
+        }
+        for (list_chunk* chunk = other.first; chunk != nullptr; chunk = chunk->next) {
+            if (chunk->live == chunk->used) {
+                add_all(chunk->slot(0), chunk->used);
+            } else {
+                for (int i = 0; i < chunk->used; i++) {
+                    if (chunk->is_live(i)) {
+                        add(*chunk->slot(i));
+                    }
+                }
+            }
+        }
+    }
+
+    // moves all elements of other to the end of this list in O(1), iterators of other stay valid
+    void splice(unrolled_list& other) {
+        if (&other == this || other.first == nullptr) {
+            return;
+        }
+        if (last != nullptr) {
+            last->next = other.first;
+            other.first->prev = last;
+        } else {
+            first = other.first;
+        }
+        last = other.last;
+        length += other.length;
+        other.first = other.last = nullptr;
+        other.length = 0;
+    }
+
+    void erase(iterator iterator) {
+        list_chunk* chunk = iterator.chunk;
+        chunk->slot(iterator.index)->~T();
+        chunk->live_mask &= ~(uint64_t(1) << iterator.index);
+        chunk->live--;
+        length--;
+        if (chunk->live == 0) {
+            release_chunk(chunk);
+        }
+    }
+
+    void print() const {
+        std::cout << "[";
+        for (auto it = begin(); it != end(); it++) {
+            std::cout << *it << ", ";
+        }
+        std::cout << "]";
+    }
+
+    // destroys elements, chunks are kept for reuse
+    void clear() {
+        while (first != nullptr) {
+            list_chunk* chunk = first;
+            for (int i = 0; i < chunk->used; i++) {
+                if (chunk->is_live(i)) {
+                    chunk->slot(i)->~T();
+                }
+            }
+            release_chunk(chunk);
+        }
+        length = 0;
+    }
+
+    // returns memory of unused chunks
+    void shrink_to_fit() {
+        while (free_chunks != nullptr) {
+            list_chunk* next = free_chunks->next;
+            delete(free_chunks);
+            free_chunks = next;
+        }
+    }
+
+    int get_length() const {
+        return length;
+    }
+
+    ~unrolled_list() {
+        clear();
+        shrink_to_fit();
+    }
+};
+
+#endif